@@ -16,7 +16,10 @@
 #include "problems/transport/smvsdm2.hpp"
 #include "problems/transport/tsdm.hpp"
 #include "problems/transport/lpsdm.hpp"
+#include "problems/transport/src/kernels.hpp"
 
+#include "mixed.hpp"
+#include "sweep.hpp"
 #include "utils.hpp"
 
 void
@@ -41,9 +44,14 @@ run()
 //         "Berlin-Mitte-Center"; // 398 / 36 // FAIL at start with mu = 1e-2 (nan) - WTF????
 //         "Austin";
 
-    auto problem = transport::SmVSDM2(path, name);
+    auto problem = transport::SmVSDM2(path, name, transport::Layout::NodeMajor);
     double mu = 1e1;
     problem.set_mu(mu);
+//     problem.set_pruning(1e-8); // pays off for mu <= 1e-2
+//     problem.set_threads(8);
+//     blas::set_threads(8);
+    printf("blas: %s\n", blas::backend_name());
+    printf("transport kernels: %s\n", transport::kernels::backend_name());
 
     std::string asd;
     asd.shrink_to_fit();
@@ -72,6 +80,9 @@ run()
 //     settings.f_min = 1e-5;
 //     settings.print_iterval_time = 0.0;
 //     settings.g_nrm2_min = 1e-3;
+//     settings.gap_min = 1e-3; // AFGM, FGM and UFGM only
+//     settings.gap_g_nrm2_min = 1e-5;
+//     settings.log_gap = true;
 
     auto ls = line_search::HSimple();
 //     auto ls = line_search::Parabolic(2, true);
@@ -108,6 +119,13 @@ run()
 
 //     problem.restore_flow(point);
     method.optimize(problem, point, settings, state);
+
+//     // float iterations first, then double ones
+//     auto f_problem = transport::BasicSmVSDM2<float>(path, name, transport::Layout::NodeMajor);
+//     f_problem.set_mu(mu);
+//     auto f_ls = line_search::BasicHSimple<float>();
+//     auto f_method = local::BasicAFGM<float>(f_ls);
+//     optimize_mixed(f_method, f_problem, method, problem, point, settings, state);
 //     problem.emoe(point);
 
     return;
@@ -139,6 +157,12 @@ run()
 // //         problem.restore_flow(point);
     }
 
+//     // the same continuation with separate limits for every mu
+//     optimize_sweep(method, problem, point, 3,
+//                    [&](size_t) { mu *= 0.1; problem.set_mu(mu); },
+//                    [&](size_t, const Point& p, ExitReason) { printf("mu = %e f = %e\n", mu, p.f); },
+//                    settings, state);
+
 //     local::UFGM(1e-4).optimize(problem, point, settings);
 }
 
@@ -1,10 +1,14 @@
 #include "quadratic.hpp"
 
 #include "core/problem.hpp"
+#include "core/thread_pool.hpp"
 
 namespace problem
 {
 
+// Ranges of parallel evaluation
+static const size_t BLOCK = 1 << 14;
+
 Quadratic::Quadratic(size_t n)
     : Problem("Test quadratic problem", n, ProblemProperty::Gradient)
     , m_k(n)
@@ -19,25 +23,36 @@ Quadratic::Quadratic(size_t n)
 void
 Quadratic::f(Point& p)
 {
-    double k = 1.0;
+    const auto& x = p.x;
 
-    p.f = 0.0;
-    for (size_t i = 0; i < m_size; ++i)
+    auto block_f = [this, &x](size_t begin, size_t end, size_t)
     {
-        p.f += k * (p.x[i] - 1.0) * (p.x[i] - 1.0);
-        k += 1.0;
-    }
+        double f = 0.0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            f += m_k[i] * (x[i] - 1.0) * (x[i] - 1.0);
+        }
+        return f;
+    };
+
+    // blocks are summed in order, so f does not depend on the number of threads
+    p.f = ThreadPool::shared().parallel_reduce(
+        0, m_size, BLOCK, 0.0, block_f, [](double a, double b) { return a + b; }, m_threads);
 }
 
 void
 Quadratic::df(Point& p)
 {
-    double k = 2.0;
-    for (size_t i = 0; i < m_size; ++i)
+    const auto& x = p.x;
+    auto& g = p.g;
+
+    ThreadPool::shared().parallel_for(0, m_size, BLOCK, [this, &x, &g](size_t begin, size_t end, size_t)
     {
-        p.g[i] = k * (p.x[i] - 1.0);
-        k += 2.0;
-    }
+        for (size_t i = begin; i < end; ++i)
+        {
+            g[i] = 2.0 * m_k[i] * (x[i] - 1.0);
+        }
+    }, m_threads);
 }
 
 }
@@ -1,10 +1,12 @@
 #include "lpsdm.hpp"
 
+#include "core/blas.hpp"
+
 namespace transport
 {
 
-LPSDM::LPSDM(const String& path, const String& name)
-    : SDM("LPSDM", path, name)
+LPSDM::LPSDM(const String& path, const String& name, Layout layout)
+    : SDM("LPSDM", path, name, layout)
 {
     T_size = m_size;
     m_size += data.edges.size();
@@ -19,13 +21,12 @@ LPSDM::f(Point& p)
     p.f = 0.0;
 
     double phi1 = 0.0;
-    for (const auto& trip : data.trips)
+    for (size_t k = 0; k < data.trips.size(); ++k)
     {
-        const auto i = trip.source;
-        const auto j = trip.target;
-        const auto d = trip.flow;
+        const auto& trip = trip_index[k];
+        const auto d = data.trips[k].flow;
 
-        phi1 -= d * T(x, i, j);
+        phi1 -= d * T(x, trip.row, trip.target);
     }
     p.f += phi1;
 
@@ -42,10 +43,10 @@ LPSDM::f(Point& p)
     p.f += phi2;
 
     double phi3 = 0.0;
-    for (auto s : data.sources)
+    for (uint32_t s = 0; s < data.sources.size(); ++s)
     {
         // T_ss = 0
-        const auto z = T(x, s, s);
+        const auto z = T(x, s, source_column[s]);
         phi3 += K * z * z;
     }
     p.f += phi3;
@@ -67,13 +68,12 @@ LPSDM::f(Point& p)
     p.f += phi4;
 
     double phi5 = 0.0;
-    uint32_t k = 0;
-    for (const auto& edge : data.edges)
+    for (uint32_t k = 0; k < data.edges.size(); ++k)
     {
-        const auto i = edge.source;
-        const auto j = edge.target;
+        const auto i = edge_index[k].source;
+        const auto j = edge_index[k].target;
 
-        for (auto s : data.sources)
+        for (uint32_t s = 0; s < data.sources.size(); ++s)
         {
             const auto z = T(x, s, j) - T(x, s, i) - x[T_size + k];
 
@@ -82,7 +82,6 @@ LPSDM::f(Point& p)
                 phi5 += K * z * z;
             }
         }
-        ++k;
     }
     p.f += phi5;
 }
@@ -94,13 +93,14 @@ LPSDM::df(Point& p)
     auto& g = p.g;
     uint32_t i;
 
-    for (const auto& trip : data.trips)
+    blas::set_zero(g);
+
+    for (size_t k = 0; k < data.trips.size(); ++k)
     {
-        const auto i = trip.source;
-        const auto j = trip.target;
-        const auto d = trip.flow;
+        const auto& trip = trip_index[k];
+        const auto d = data.trips[k].flow;
 
-        T(g, i, j) -= d;
+        T(g, trip.row, trip.target) -= d;
     }
 
     i = 0;
@@ -112,9 +112,9 @@ LPSDM::df(Point& p)
         ++i;
     }
 
-    for (auto s : data.sources)
+    for (uint32_t s = 0; s < data.sources.size(); ++s)
     {
-        T(g, s, s) += 2.0 * K * T(x, s, s);
+        T(g, s, source_column[s]) += 2.0 * K * T(x, s, source_column[s]);
     }
 
     i = 0;
@@ -130,13 +130,12 @@ LPSDM::df(Point& p)
         ++i;
     }
 
-    uint32_t k = 0;
-    for (const auto& edge : data.edges)
+    for (uint32_t k = 0; k < data.edges.size(); ++k)
     {
-        const auto i = edge.source;
-        const auto j = edge.target;
+        const auto i = edge_index[k].source;
+        const auto j = edge_index[k].target;
 
-        for (auto s : data.sources)
+        for (uint32_t s = 0; s < data.sources.size(); ++s)
         {
             const auto z = T(x, s, j) - T(x, s, i) - x[T_size + k];
 
@@ -147,7 +146,6 @@ LPSDM::df(Point& p)
                 g[T_size + k] -= 2.0 * K * z;
             }
         }
-        ++k;
     }
 }
 
@@ -158,13 +156,12 @@ LPSDM::emoe(Point& point)
     uint32_t i;
 
     double phi1 = 0.0;
-    for (const auto& trip : data.trips)
+    for (size_t k = 0; k < data.trips.size(); ++k)
     {
-        const auto i = trip.source;
-        const auto j = trip.target;
-        const auto d = trip.flow;
+        const auto& trip = trip_index[k];
+        const auto d = data.trips[k].flow;
 
-        phi1 -= d * T(x, i, j);
+        phi1 -= d * T(x, trip.row, trip.target);
     }
     printf("phi1 = %e\n", phi1);
 
@@ -181,10 +178,10 @@ LPSDM::emoe(Point& point)
     printf("phi2 = %e\n", phi2);
 
     double phi3 = 0.0;
-    for (auto s : data.sources)
+    for (uint32_t s = 0; s < data.sources.size(); ++s)
     {
         // T_ss = 0
-        const auto z = T(x, s, s);
+        const auto z = T(x, s, source_column[s]);
         phi3 += K * z * z;
     }
     printf("phi3 = %e\n", phi3 / K);
@@ -206,13 +203,12 @@ LPSDM::emoe(Point& point)
     printf("phi4 = %e\n", phi4 / K);
 
     double phi5 = 0.0;
-    uint32_t k = 0;
-    for (const auto& edge : data.edges)
+    for (uint32_t k = 0; k < data.edges.size(); ++k)
     {
-        const auto i = edge.source;
-        const auto j = edge.target;
+        const auto i = edge_index[k].source;
+        const auto j = edge_index[k].target;
 
-        for (auto s : data.sources)
+        for (uint32_t s = 0; s < data.sources.size(); ++s)
         {
             const auto z = T(x, s, j) - T(x, s, i) - x[T_size + k];
 
@@ -221,7 +217,6 @@ LPSDM::emoe(Point& point)
                 phi5 += K * z * z;
             }
         }
-        ++k;
     }
     printf("phi5 = %e\n", phi5 / K);
 }
@@ -231,15 +226,16 @@ LPSDM::restore_flow(Point& point)
 {
     const auto& x = point.x;
 
-    for (const auto& edge : data.edges)
+    for (size_t e = 0; e < data.edges.size(); ++e)
     {
+        const auto& edge = data.edges[e];
         const auto i = edge.source;
         const auto j = edge.target;
 
         const auto f = edge.capacity;
 //         const auto t = edge.free_flow_time;
 
-        auto pair = calc_exp_sum(x, edge, 1e-8);
+        auto pair = calc_exp_sum(x, e, 1e-8);
         auto u_max = pair.first;
         auto exp_sum = pair.second;
 
@@ -8,7 +8,7 @@ namespace transport
 class LPSDM : public SDM
 {
 public:
-    LPSDM(const String& path, const String& name);
+    LPSDM(const String& path, const String& name, Layout layout = Layout::SourceMajor);
 
     void
     f(Point& p) override;
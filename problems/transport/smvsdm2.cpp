@@ -1,18 +1,33 @@
 #include "smvsdm2.hpp"
 
+#include <algorithm>
+
+#include "src/kernels.hpp"
+
 #include "core/blas.hpp"
 
 namespace transport
 {
 
-SmVSDM2::SmVSDM2(const String & path, const String & name)
-    : SDM("SmVSDM2", path, name)
+template <typename Real>
+BasicSmVSDM2<Real>::BasicSmVSDM2(const String& path, const String& name, Layout layout)
+    : BasicSDM<Real>("SmVSDM2", path, name, layout)
+    , prune_k(0.0)
+    , prune_margin(0.0)
 {
     m_properties |= ProblemProperty::LipschitzConstant;
+    m_properties |= ProblemProperty::DualPoint;
+    // with source-major layout line_f() gathers twice as many strided columns as f(), which
+    // costs more than forming the probe point
+    if (layout == Layout::NodeMajor)
+    {
+        m_properties |= ProblemProperty::LineEvaluation;
+    }
     set_mu(1.0);
 
 //     m_dual_size = m_size * m_size; // FIXME add sparsity
-    m_dual_size = data.edges.size();
+    m_dual_size = data.edges.size() + 1;
+    edge_flow.setZero(data.edges.size());
 
     double d_min = std::numeric_limits<double>::max();
     double d_max = std::numeric_limits<double>::lowest();
@@ -29,8 +44,9 @@ SmVSDM2::SmVSDM2(const String & path, const String & name)
     printf("d: min = %e; max = %e; med = %e\n", d_min, d_max, d_med);
 }
 
+template <typename Real>
 void
-SmVSDM2::set_mu(double mu)
+BasicSmVSDM2<Real>::set_mu(double mu)
 {
     this->mu = mu;
 
@@ -47,10 +63,176 @@ SmVSDM2::set_mu(double mu)
     m_l = max_f / (mu * min_tf);
 
     printf("mu = %e L = %e\n", mu, m_l);
+
+    // active sets depend on mu
+    prune_x.resize(0);
+}
+
+template <typename Real>
+void
+BasicSmVSDM2<Real>::set_pruning(double tol, double margin)
+{
+    // sources * exp(-prune_k) = tol, the maximum term is 1
+    prune_k = tol > 0.0 ? std::log(data.sources.size() / tol) : 0.0;
+    prune_margin = margin;
+
+    prune_x.resize(0);
+    edge_drift.assign(data.edges.size(), 0.0);
+    edge_active.resize(data.edges.size());
+    edge_dense.assign(data.edges.size(), 1);
+}
+
+// Potentials block size of the parallel drift calculation
+static const size_t DRIFT_BLOCK = 1 << 16;
+
+template <typename Real>
+double
+BasicSmVSDM2<Real>::prune_drift(const Vector<Real>& x)
+{
+    double drift = limits<double>::infinity();
+    if (prune_x.size() == x.size() && m_threads > 1)
+    {
+        auto block_drift = [this, &x](size_t begin, size_t end, size_t /*thread*/)
+        {
+            return (x.segment(begin, end - begin) - prune_x.segment(begin, end - begin))
+                .template lpNorm<Eigen::Infinity>();
+        };
+
+        drift = ThreadPool::shared().parallel_reduce(
+            0, x.size(), DRIFT_BLOCK, 0.0, block_drift, [](double a, double b) { return std::max(a, b); }, m_threads);
+    }
+    else if (prune_x.size() == x.size())
+    {
+        drift = (x - prune_x).template lpNorm<Eigen::Infinity>();
+    }
+
+    // see pruned_exp_sum()
+    size_t outdated = 0;
+    for (size_t e = 0; e < data.edges.size(); ++e)
+    {
+        outdated += 4.0 * (drift + edge_drift[e]) > prune_margin * data.edges[e].free_flow_time * mu;
+    }
+
+    if (outdated * 2 > data.edges.size())
+    {
+        prune_x = x;
+        drift = 0.0;
+        std::fill(edge_drift.begin(), edge_drift.end(), limits<double>::infinity());
+    }
+
+    return drift;
+}
+
+// Potentials move by less than drift + edge_drift[e] since the active set was built, so every u_s
+// and the maximum (its source is active) move by less than delta = 2 * (drift + edge_drift[e]) / (t * mu).
+// Sources which were prune_margin below prune_k then are still prune_k below the maximum while
+// 2 * delta <= prune_margin.
+template <typename Real>
+std::pair<double, double>
+BasicSmVSDM2<Real>::pruned_exp_sum(const Vector<Real>& x, size_t e, double drift, Real* work)
+{
+    const auto& edge = data.edges[e];
+    const auto i = edge_index[e].source;
+    const auto j = edge_index[e].target;
+    const auto t = edge.free_flow_time;
+    const auto d = t * mu;
+
+    auto& active = edge_active[e];
+    if (4.0 * (drift + edge_drift[e]) > prune_margin * d)
+    {
+        const auto sources = data.sources.size();
+        const auto u_max = kernels::scaled_diff_max(&T(x, 0, j), &T(x, 0, i), row_stride, sources, t, d, work);
+        const auto bound = u_max - prune_k - prune_margin;
+
+        active.clear();
+        for (uint32_t s = 0; s < sources; ++s)
+        {
+            if (work[s] >= bound)
+            {
+                active.push_back(s);
+            }
+        }
+
+        edge_drift[e] = drift;
+
+        // gathers are slower than full SIMD kernels for dense sets
+        if (active.size() * 2 >= sources)
+        {
+            active.clear();
+            edge_dense[e] = true;
+
+            auto exp_sum = kernels::exp_sum(work, sources, u_max);
+            exp_sum += std::exp(-u_max);
+
+            return std::make_pair(u_max, exp_sum);
+        }
+
+        edge_dense[e] = false;
+    }
+
+    if (edge_dense[e])
+    {
+        return calc_exp_sum(x, e, mu, work);
+    }
+
+    const auto u_max = kernels::indexed_scaled_diff_max(
+        &T(x, 0, j), &T(x, 0, i), row_stride, active.data(), active.size(), t, d, work);
+
+    auto exp_sum = kernels::exp_sum(work, active.size(), u_max);
+    exp_sum += std::exp(-u_max);
+
+    return std::make_pair(u_max, exp_sum);
 }
 
+template <typename Real>
 void
-SmVSDM2::restore_flow(Point& point)
+BasicSmVSDM2<Real>::scatter_edge(Vector<Real>& g, size_t e, double c)
+{
+    const auto i = edge_index[e].source;
+    const auto j = edge_index[e].target;
+
+    if (prune_k > 0.0 && edge_dense[e] == 0)
+    {
+        const auto& active = edge_active[e];
+        kernels::indexed_scatter(&T(g, 0, j), &T(g, 0, i), row_stride, active.data(), active.size(), work.data(), c);
+    }
+    else
+    {
+        kernels::scatter(&T(g, 0, j), &T(g, 0, i), row_stride, data.sources.size(), work.data(), c);
+    }
+}
+
+// Traffic of the serial kernels, caches reuse between edges is ignored. Every edge reads
+// two potential columns, scatter updates two gradient columns and the gradient is cleared
+// once. Trips touch 2 (f) or 4 (df) single values.
+
+template <typename Real>
+double
+BasicSmVSDM2<Real>::f_bytes() const
+{
+    const double column = data.sources.size() * sizeof(Real);
+    return data.edges.size() * 2.0 * column + data.trips.size() * 2.0 * sizeof(Real);
+}
+
+template <typename Real>
+double
+BasicSmVSDM2<Real>::df_bytes() const
+{
+    const double column = data.sources.size() * sizeof(Real);
+    return data.edges.size() * 6.0 * column + nodes_count * column + data.trips.size() * 4.0 * sizeof(Real);
+}
+
+template <typename Real>
+double
+BasicSmVSDM2<Real>::fdf_bytes() const
+{
+    // exp sums are shared by f and df
+    return df_bytes();
+}
+
+template <typename Real>
+void
+BasicSmVSDM2<Real>::restore_flow(Point& point)
 {
 //     const auto& x = point.x;
     auto& x = point.x;
@@ -72,7 +254,7 @@ SmVSDM2::restore_flow(Point& point)
     DVector flow(data.edges.size());
     for (size_t i = 0; i < data.edges.size(); ++i)
     {
-        auto pair = calc_exp_sum(x, data.edges[i], mu);
+        auto pair = calc_exp_sum(x, i, mu);
         auto u_max = pair.first;
         auto exp_sum = pair.second;
 
@@ -83,8 +265,8 @@ SmVSDM2::restore_flow(Point& point)
     auto t_min = limits<double>::max();
     for (size_t i = 0; i < (size_t)x.size(); ++i)
     {
-        t_max = std::max(t_max, x[i]);
-        t_min = std::min(t_min, x[i]);
+        t_max = std::max<double>(t_max, x[i]);
+        t_min = std::min<double>(t_min, x[i]);
     }
 
     printf("t_max = %e t_min = %e\n", t_max, t_min);
@@ -131,8 +313,9 @@ SmVSDM2::restore_flow(Point& point)
     }
 }
 
+template <typename Real>
 void
-SmVSDM2::f(Point& p)
+BasicSmVSDM2<Real>::f(Point& p)
 {
     // FIXME move into class
 //     static const double l_log = std::log(1.0 / (1.0 + data.sources.size()));
@@ -141,11 +324,18 @@ SmVSDM2::f(Point& p)
     const auto& x = p.x;
 
     p.f = 0.0;
-    if (mu > 0.0)
+    if (mu > 0.0 && m_threads > 1)
     {
-        for (const auto& edge : data.edges)
+        p.f = parallel_exp_sums(x) * mu;
+    }
+    else if (mu > 0.0)
+    {
+        const auto drift = prune_k > 0.0 ? prune_drift(x) : 0.0;
+        for (size_t e = 0; e < data.edges.size(); ++e)
         {
-            auto pair = calc_exp_sum(x, edge, mu);
+            const auto& edge = data.edges[e];
+
+            auto pair = prune_k > 0.0 ? pruned_exp_sum(x, e, drift, work.data()) : calc_exp_sum(x, e, mu);
             auto u_max = pair.first;
             auto exp_sum = pair.second;
 
@@ -156,17 +346,17 @@ SmVSDM2::f(Point& p)
         p.f *= mu;
     }
 
-    for (const auto& trip : data.trips)
+    for (size_t t = 0; t < data.trips.size(); ++t)
     {
-        const auto s = trip.source;
-        const auto k = trip.target;
+        const auto& trip = trip_index[t];
 
-        p.f -= trip.flow * (T(x, s, k) - T(x, s, s));
+        p.f -= data.trips[t].flow * (T(x, trip.row, trip.target) - T(x, trip.row, trip.source));
     }
 }
 
+template <typename Real>
 void
-SmVSDM2::df(Point& p)
+BasicSmVSDM2<Real>::df(Point& p)
 {
     // FIXME move into class
 //     static const double l_log = std::log(1.0 / (1.0 + data.sources.size()));
@@ -174,95 +364,411 @@ SmVSDM2::df(Point& p)
     const auto& x = p.x;
     auto& g = p.g;
 
-    for (const auto& edge : data.edges)
+    if (m_threads > 1)
+    {
+        parallel_exp_sums(x);
+        parallel_scatter(x, g);
+        parallel_flows();
+    }
+    else
     {
-        const auto i = edge.source;
-        const auto j = edge.target;
-        const auto f = edge.capacity;
+        blas::set_zero(g);
+        const auto drift = prune_k > 0.0 ? prune_drift(x) : 0.0;
+        for (size_t e = 0; e < data.edges.size(); ++e)
+        {
+            const auto f = data.edges[e].capacity;
+
+            const auto pair = prune_k > 0.0 ? pruned_exp_sum(x, e, drift, work.data()) : calc_exp_sum(x, e, mu);
+            const auto exp_sum = pair.second;
+            const auto exp_sum_inv = 1.0 / exp_sum;
 
-        const auto pair = calc_exp_sum(x, edge, mu);
-        const auto exp_sum = pair.second;
-        const auto exp_sum_inv = 1.0 / exp_sum;
+            // flow is the sum of scattered values, exp_sum includes exp(-u_max) of the free term
+            edge_flow[e] = f * (1.0 - std::exp(-pair.first) * exp_sum_inv);
 
-        size_t k = 0;
-        for (auto s : data.sources)
+            // g_sj += g_sji; g_si -= g_sji, where g_sji = work[s] * f / exp_sum
+            scatter_edge(g, e, f * exp_sum_inv);
+        }
+    }
+
+    for (size_t t = 0; t < data.trips.size(); ++t)
+    {
+        const auto& trip = trip_index[t];
+
+        T(g, trip.row, trip.target) -= data.trips[t].flow;
+        T(g, trip.row, trip.source) += data.trips[t].flow;
+    }
+}
+
+template <typename Real>
+void
+BasicSmVSDM2<Real>::fdf(Point& p)
+{
+    if (mu <= 0.0)
+    {
+        Problem::fdf(p);
+        return;
+    }
+
+    const auto& x = p.x;
+    auto& g = p.g;
+
+    // same as f() + df(), but exp sums are calculated only once per edge
+    p.f = 0.0;
+    if (m_threads > 1)
+    {
+        p.f = parallel_exp_sums(x);
+        parallel_scatter(x, g);
+        parallel_flows();
+    }
+    else
+    {
+        blas::set_zero(g);
+        const auto drift = prune_k > 0.0 ? prune_drift(x) : 0.0;
+        for (size_t e = 0; e < data.edges.size(); ++e)
         {
-            const auto g_sji = work[k] * f * exp_sum_inv;
-            T(g, s, j) += g_sji;
-            T(g, s, i) -= g_sji;
+            const auto& edge = data.edges[e];
+            const auto f = edge.capacity;
 
-            ++k;
+            const auto pair = prune_k > 0.0 ? pruned_exp_sum(x, e, drift, work.data()) : calc_exp_sum(x, e, mu);
+            const auto u_max = pair.first;
+            const auto exp_sum = pair.second;
+            const auto exp_sum_inv = 1.0 / exp_sum;
+
+            p.f += edge.free_flow_time * f * (u_max + std::log(exp_sum));
+            edge_flow[e] = f * (1.0 - std::exp(-u_max) * exp_sum_inv);
+
+            scatter_edge(g, e, f * exp_sum_inv);
         }
     }
+    p.f *= mu;
 
-    for (const auto& trip : data.trips)
+    for (size_t t = 0; t < data.trips.size(); ++t)
     {
-        const auto s = trip.source;
-        const auto k = trip.target;
+        const auto& trip = trip_index[t];
+        const auto d = data.trips[t].flow;
 
-        T(g, s, k) -= trip.flow;
-        T(g, s, s) += trip.flow;
+        p.f -= d * (T(x, trip.row, trip.target) - T(x, trip.row, trip.source));
+
+        T(g, trip.row, trip.target) -= d;
+        T(g, trip.row, trip.source) += d;
     }
 }
 
+// Parallel evaluation is done in two passes. The first one goes over blocks of edges and
+// calculates u_max and exp sum for every edge. The second one goes over blocks of sources,
+// every thread recalculates exp terms for its own sources only and scatters them into its
+// own gradient rows, so there are no write conflicts between threads.
+
+// Edges block size of the first pass. The sum of f terms is reduced per block and blocks
+// are summed in order, so f value does not depend on the number of threads.
+static const size_t EDGES_BLOCK = 256;
+
+// Sources blocks of the second pass are multiples of this value. It keeps blocks aligned
+// with SIMD lanes, so the gradient is the same as the serial one.
+static const size_t SOURCES_BLOCK = 8;
+
+template <typename Real>
+double
+BasicSmVSDM2<Real>::parallel_exp_sums(const Vector<Real>& x)
+{
+    const auto edges = data.edges.size();
+
+    edge_u_max.resize(edges);
+    edge_exp_sum.resize(edges);
+
+    // active sets are per edge, so edge blocks update them without conflicts
+    const auto drift = prune_k > 0.0 ? prune_drift(x) : 0.0;
+
+    auto block_f = [this, &x, drift](size_t begin, size_t end, size_t thread)
+    {
+        const auto work = thread_work[thread].data();
+
+        double f = 0.0;
+        for (size_t e = begin; e < end; ++e)
+        {
+            const auto& edge = data.edges[e];
+
+            const auto pair = prune_k > 0.0 ? pruned_exp_sum(x, e, drift, work) : calc_exp_sum(x, e, mu, work);
+            edge_u_max[e] = pair.first;
+            edge_exp_sum[e] = pair.second;
+
+            f += edge.free_flow_time * edge.capacity * (pair.first + std::log(pair.second));
+        }
+
+        return f;
+    };
+
+    return ThreadPool::shared().parallel_reduce(
+        0, edges, EDGES_BLOCK, 0.0, block_f, [](double a, double b) { return a + b; }, m_threads);
+}
+
+template <typename Real>
 void
-SmVSDM2::dual_x(Point& p, Point& dual_p)
+BasicSmVSDM2<Real>::parallel_scatter(const Vector<Real>& x, Vector<Real>& g)
 {
-    auto& flow = dual_p.x;
-    for (size_t i = 0; i < data.edges.size(); ++i)
+    const size_t sources = data.sources.size();
+
+    auto block = (sources + m_threads - 1) / m_threads;
+    block = (block + SOURCES_BLOCK - 1) / SOURCES_BLOCK * SOURCES_BLOCK;
+
+    auto scatter = [this, &x, &g](size_t begin, size_t end, size_t thread)
     {
-        auto pair = calc_exp_sum(p.x, data.edges[i], mu);
-        auto u_max = pair.first;
-        auto exp_sum = pair.second;
+        auto work = thread_work[thread].data();
 
-        flow[i] = data.edges[i].capacity * (1.0 - std::exp(-u_max) / exp_sum);
+        const uint32_t s = begin;
+        const auto count = end - begin;
+
+        set_zero_rows(g, s, count);
+
+        for (size_t e = 0; e < data.edges.size(); ++e)
+        {
+            const auto& edge = data.edges[e];
+            const auto i = edge_index[e].source;
+            const auto j = edge_index[e].target;
+            const auto t = edge.free_flow_time;
+
+            const auto c = edge.capacity * (1.0 / edge_exp_sum[e]);
+
+            if (prune_k > 0.0 && edge_dense[e] == 0)
+            {
+                // active sources are sorted, take the ones of this block
+                const auto& active = edge_active[e];
+                const auto first = std::lower_bound(active.data(), active.data() + active.size(), s);
+                const auto last = std::lower_bound(first, active.data() + active.size(), s + count);
+                const auto n = last - first;
+
+                kernels::indexed_scaled_diff_max(&T(x, 0, j), &T(x, 0, i), row_stride, first, n, t, t * mu, work);
+                kernels::exp_sum(work, n, edge_u_max[e]);
+                kernels::indexed_scatter(&T(g, 0, j), &T(g, 0, i), row_stride, first, n, work, c);
+                continue;
+            }
+
+            kernels::scaled_diff_max(&T(x, s, j), &T(x, s, i), row_stride, count, t, t * mu, work);
+            kernels::exp_sum(work, count, edge_u_max[e]);
+            kernels::scatter(&T(g, s, j), &T(g, s, i), row_stride, count, work, c);
+        }
+    };
+
+    ThreadPool::shared().parallel_for(0, sources, block, scatter, m_threads);
+}
+
+template <typename Real>
+void
+BasicSmVSDM2<Real>::parallel_flows()
+{
+    for (size_t e = 0; e < data.edges.size(); ++e)
+    {
+        edge_flow[e] = data.edges[e].capacity * (1.0 - std::exp(-edge_u_max[e]) / edge_exp_sum[e]);
     }
 }
 
+// Values are the same as f() gives, edge terms of serial evaluation are summed in one block
+template <typename Real>
 void
-SmVSDM2::dual_f(Point& dual_p)
+BasicSmVSDM2<Real>::f_batch(Point* const* points, size_t k)
 {
-    auto z = [this](double flow, double free_flow_time, double capacity) -> double
+    const size_t sources = data.sources.size();
+
+    auto block_f = [this, points, k, sources](size_t begin, size_t end, size_t thread)
     {
-        double res = 0.0;
+        auto w = m_threads > 1 ? thread_work[thread].data() : work.data();
 
-        res += mu * (flow - capacity);
-        if (std::fabs(res) < 1e-8)
+        std::vector<double> sums(k, 0.0);
+        for (size_t e = begin; e < end; ++e)
         {
-            res = 0.0;
+            const auto& edge = data.edges[e];
+            const auto i = edge_index[e].source;
+            const auto j = edge_index[e].target;
+            const auto t = edge.free_flow_time;
+            const auto c = t * edge.capacity;
+
+            for (size_t p = 0; p < k; ++p)
+            {
+                const auto& x = points[p]->x;
+
+                const auto u_max = kernels::scaled_diff_max(&T(x, 0, j), &T(x, 0, i), row_stride, sources, t, t * mu, w);
+                const auto exp_sum = kernels::exp_sum(w, sources, u_max) + std::exp(-u_max);
+
+                sums[p] += c * (u_max + std::log(exp_sum));
+            }
+        }
+
+        return sums;
+    };
+
+    auto add = [](std::vector<double> a, const std::vector<double>& b)
+    {
+        for (size_t p = 0; p < a.size(); ++p)
+        {
+            a[p] += b[p];
+        }
+        return a;
+    };
+
+    std::vector<double> sums(k, 0.0);
+    if (mu > 0.0 && m_threads > 1)
+    {
+        sums = ThreadPool::shared().parallel_reduce(0, data.edges.size(), EDGES_BLOCK, sums, block_f, add, m_threads);
+    }
+    else if (mu > 0.0)
+    {
+        sums = block_f(0, data.edges.size(), 0);
+    }
+
+    for (size_t p = 0; p < k; ++p)
+    {
+        const auto& x = points[p]->x;
+
+        points[p]->f = sums[p] * mu;
+        for (size_t t = 0; t < data.trips.size(); ++t)
+        {
+            const auto& trip = trip_index[t];
+
+            points[p]->f -= data.trips[t].flow * (T(x, trip.row, trip.target) - T(x, trip.row, trip.source));
         }
-        else
+    }
+}
+
+template <typename Real>
+void
+BasicSmVSDM2<Real>::line_setup(const Vector<Real>& x, const Vector<Real>& dir)
+{
+    this->setup_line(x, dir);
+}
+
+// Same terms as f(), but the scaled differences of an edge are calculated from x and dir columns,
+// so x + t * dir is neither formed (axpyz) nor written and read back by every probe
+template <typename Real>
+double
+BasicSmVSDM2<Real>::line_f(double t, double* dphi)
+{
+    const auto& x = *line_x;
+    const auto& dir = *line_dir;
+    const size_t sources = data.sources.size();
+
+    auto block_f = [this, &x, &dir, t, dphi, sources](size_t begin, size_t end, size_t thread)
+    {
+        auto w = m_threads > 1 ? thread_work[thread].data() : work.data();
+
+        // f and derivative sums
+        std::pair<double, double> sums(0.0, 0.0);
+        for (size_t e = begin; e < end; ++e)
         {
-            res *= log(capacity / (capacity - flow));
+            const auto& edge = data.edges[e];
+            const auto i = edge_index[e].source;
+            const auto j = edge_index[e].target;
+            const auto d = edge.free_flow_time * mu;
+
+            const auto u_max = kernels::line_scaled_diff_max(
+                &T(x, 0, j), &T(x, 0, i), &T(dir, 0, j), &T(dir, 0, i), row_stride, sources,
+                t, edge.free_flow_time, d, w);
+            const auto exp_sum = kernels::exp_sum(w, sources, u_max) + std::exp(-u_max);
+
+            const auto c = edge.free_flow_time * edge.capacity;
+            sums.first += c * (u_max + std::log(exp_sum));
+            if (dphi)
+            {
+                // d u_s / dt = (dir_sj - dir_si) / d
+                sums.second += c / d * kernels::diff_dot(w, &T(dir, 0, j), &T(dir, 0, i), row_stride, sources) / exp_sum;
+            }
         }
 
-        res += (mu + 1.0) * flow;
-        res *= free_flow_time;
+        return sums;
+    };
 
-        return res;
+    auto add = [](const std::pair<double, double>& a, const std::pair<double, double>& b)
+    {
+        return std::make_pair(a.first + b.first, a.second + b.second);
     };
 
-//     auto z = [this](double flow, double free_flow_time, double capacity) -> double
-//     {
-//         if (flow <= capacity)
-//         {
-//             return free_flow_time * flow;
-//         }
-//
-//         return 1e300 * flow;
-//     };
+    std::pair<double, double> sums(0.0, 0.0);
+    if (mu > 0.0)
+    {
+        sums = ThreadPool::shared().parallel_reduce(0, data.edges.size(), EDGES_BLOCK, sums, block_f, add, m_threads);
+    }
 
-    // FIXME move into class
-    static const double l_log = std::log(1.0 / (1.0 + data.sources.size()));
+    double trips_dphi;
+    const auto f = mu * sums.first + this->line_trips_f(t, &trips_dphi);
 
-    dual_p.f = 0.0;
-    for (size_t i = 0; i < data.edges.size(); ++i)
+    if (dphi)
+    {
+        *dphi = mu * sums.second + trips_dphi;
+    }
+
+    return f;
+}
+
+template <typename Real>
+void
+BasicSmVSDM2<Real>::dual_x(Point& p, Point& dual_p)
+{
+    const auto edges = data.edges.size();
+
+    auto& flow = dual_p.x;
+    flow.resize(m_dual_size);
+
+    double entropy = 0.0;
+    for (size_t i = 0; i < edges; ++i)
     {
-        dual_p.f += z(dual_p.x[i], data.edges[i].free_flow_time, data.edges[i].capacity);
-        dual_p.f -= z(0.0,         data.edges[i].free_flow_time, data.edges[i].capacity);
+        const auto& edge = data.edges[i];
 
-//         dual_p.f += std::min(dual_p.x[i], data.edges[i].capacity) * data.edges[i].free_flow_time;
+        auto pair = calc_exp_sum(p.x, i, mu);
+        auto u_max = pair.first;
+        auto exp_sum = pair.second;
+
+        flow[i] = edge.capacity * (1.0 - std::exp(-u_max) / exp_sum);
+
+        // shares of sources are work[s] / exp_sum, the free share is exp(-u_max) / exp_sum
+        double h = 0.0;
+        for (size_t s = 0; s < data.sources.size(); ++s)
+        {
+            const double q = work[s] / exp_sum;
+            h += q > 0.0 ? q * std::log(q) : 0.0;
+        }
+
+        const double q = std::exp(-u_max) / exp_sum;
+        h += q > 0.0 ? q * std::log(q) : 0.0;
+
+        entropy += edge.free_flow_time * edge.capacity * h;
+    }
+
+    flow[edges] = mu * entropy;
+}
+
+// f(x) = <g, x> - sum(t_e * F_e) - mu * sum(t_e * cap_e * H_e), since f is the Lagrangian of the
+// flows and linear in x
+template <typename Real>
+void
+BasicSmVSDM2<Real>::last_dual_x(const Point& point, Point& dual_p)
+{
+    const auto edges = data.edges.size();
+
+    dual_p.x.resize(m_dual_size);
+
+    double time = 0.0;
+    for (size_t e = 0; e < edges; ++e)
+    {
+        dual_p.x[e] = edge_flow[e];
+        time += data.edges[e].free_flow_time * edge_flow[e];
     }
+
+    dual_p.x[edges] = blas::dot(point.g, point.x) - time - point.f;
 }
 
+template <typename Real>
+void
+BasicSmVSDM2<Real>::dual_f(Point& dual_p)
+{
+    const auto edges = data.edges.size();
+
+    dual_p.f = dual_p.x[edges];
+    for (size_t e = 0; e < edges; ++e)
+    {
+        dual_p.f += data.edges[e].free_flow_time * dual_p.x[e];
+    }
+}
+
+template class BasicSmVSDM2<double>;
+template class BasicSmVSDM2<float>;
+
 }
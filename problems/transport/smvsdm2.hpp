@@ -5,10 +5,14 @@
 namespace transport
 {
 
-class SmVSDM2 : public SDM
+template <typename Real>
+class BasicSmVSDM2 : public BasicSDM<Real>
 {
 public:
-    SmVSDM2(const String& path, const String& name);
+    using Point = BasicPoint<Real>;
+    using Problem = BasicProblem<Real>;
+
+    BasicSmVSDM2(const String& path, const String& name, Layout layout = Layout::SourceMajor);
 
     void
     f(Point& p) override;
@@ -16,21 +20,126 @@ public:
     void
     df(Point& p) override;
 
+    void
+    fdf(Point& p) override;
+
+    // Walks edges once for all points
+    void
+    f_batch(Point* const* points, size_t k) override;
+
+    void
+    line_setup(const Vector<Real>& x, const Vector<Real>& dir) override;
+
+    double
+    line_f(double t, double* dphi = nullptr) override;
+
     void
     set_mu(double mu);
 
+    // Skips exp terms of sources which are far below the maximum of their edge, tol = 0 (default)
+    // disables it. Skipped terms of an edge sum to less than tol of its exp sum, so f terms and
+    // flows of every edge are within tol relative error. Active sources of an edge are kept
+    // while potentials move less than margin / 4 of the edge scale (t_e * mu) in max norm.
+    // Used by f(), df() and fdf() in serial and parallel modes, line_f(), f_batch() and dual_x()
+    // use all sources.
+    void
+    set_pruning(double tol, double margin = 8.0);
+
+    double
+    f_bytes() const override;
+
+    double
+    df_bytes() const override;
+
+    double
+    fdf_bytes() const override;
+
     // FIXME remove this, replaced with dual_x()
     void
     restore_flow(Point& point);
 
+    // Dual point is edge flows followed by mu * sum(t_e * cap_e * H_e), where H_e is the
+    // negative entropy of per-source flows of the edge (shares of its capacity)
     void
     dual_x(Point & p, Point & dual_p) override;
 
+    // Travel time plus the entropy term of the dual point, f* >= <g, x*> - dual_f(y) for any
+    // flows y and their infeasibility g. The entropy term of averaged dual points is not less
+    // than the one of averaged flows (H_e is convex), so the bound holds for averages as well.
     void
     dual_f(Point & dual_p) override;
 
+    // The same as dual_x() gives, edge flows of the last df() / fdf() and the entropy term,
+    // which is recovered from f, g and x of the point with one dot product
+    void
+    last_dual_x(const Point& point, Point& dual_p) override;
+
 private:
+    double
+    parallel_exp_sums(const Vector<Real>& x);
+
+    void
+    parallel_scatter(const Vector<Real>& x, Vector<Real>& g);
+
+    // Edge flows from the results of parallel_exp_sums()
+    void
+    parallel_flows();
+
+    // Returns |x - prune_x| in max norm, moves prune_x to x (and rebuilds all active sets) when
+    // most of active sets are outdated
+    double
+    prune_drift(const Vector<Real>& x);
+
+    // Same as calc_exp_sum(), but for active sources of the edge only, work[k] is the exp term
+    // of the source edge_active[e][k] (of the source k for dense edges). Updates active set of
+    // the edge only, so different edges can be processed in parallel.
+    std::pair<double, double>
+    pruned_exp_sum(const Vector<Real>& x, size_t e, double drift, Real* work);
+
+    // g_sj += c * work[s]; g_si -= c * work[s] over all or active sources of the edge
+    void
+    scatter_edge(Vector<Real>& g, size_t e, double c);
+
     double mu;
+
+    // per edge results of parallel_exp_sums()
+    DVector edge_u_max;
+    DVector edge_exp_sum;
+
+    // see last_dual_x()
+    DVector edge_flow;
+
+    // see set_pruning(), prune_k is 0 if pruning is disabled
+    double prune_k;
+    double prune_margin;
+    // reference point of active sets
+    Vector<Real> prune_x;
+    // |x - prune_x| in max norm at the time active set of the edge was built
+    std::vector<double> edge_drift;
+    std::vector<std::vector<uint32_t>> edge_active;
+    // active set of the edge is too large, all sources are used (not bool, edges are updated
+    // by several threads)
+    std::vector<uint8_t> edge_dense;
+
+    using Problem::m_properties;
+    using Problem::m_l;
+    using Problem::m_dual_size;
+    using Problem::m_threads;
+
+    using BasicSDM<Real>::data;
+    using BasicSDM<Real>::work;
+    using BasicSDM<Real>::thread_work;
+    using BasicSDM<Real>::row_stride;
+    using BasicSDM<Real>::nodes_count;
+    using BasicSDM<Real>::edge_index;
+    using BasicSDM<Real>::trip_index;
+    using BasicSDM<Real>::T;
+    using BasicSDM<Real>::set_zero_rows;
+    using BasicSDM<Real>::calc_exp_sum;
+    using BasicSDM<Real>::line_x;
+    using BasicSDM<Real>::line_dir;
 };
 
+using SmVSDM2 = BasicSmVSDM2<double>;
+
 }
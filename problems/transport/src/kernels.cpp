@@ -0,0 +1,63 @@
+#include "kernels.hpp"
+
+namespace transport
+{
+
+namespace kernels
+{
+
+namespace
+{
+
+const backend::Backend*
+select_backend()
+{
+#ifdef T_OPT_BLAS_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return backend::avx512_backend();
+    }
+
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        return backend::avx2_backend();
+    }
+#endif
+
+    return backend::scalar_backend();
+}
+
+inline const backend::Backend&
+selected_backend()
+{
+    static const backend::Backend* b = select_backend();
+    return *b;
+}
+
+}
+
+template <>
+const backend::Kernels<double>&
+selected()
+{
+    return selected_backend().f64;
+}
+
+template <>
+const backend::Kernels<float>&
+selected()
+{
+    return selected_backend().f32;
+}
+
+const char*
+backend_name()
+{
+    return selected_backend().name;
+}
+
+}
+
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "kernels_backend.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// Loops over sources for a single edge. Values for sources are placed with the given stride
+// (1 for node-major layout, nodes count for source-major one). Only unit stride loops are
+// vectorized, with AVX-512 or AVX2 (+FMA) kernels selected at runtime for the host CPU, see
+// kernels_simd.hpp.
+
+namespace transport
+{
+
+namespace kernels
+{
+
+// Kernels of the best instruction set supported by the host CPU, chosen on the first call
+template <typename Real>
+const backend::Kernels<Real>&
+selected();
+
+// Name of the selected instruction set: "avx512", "avx2" or "scalar"
+const char*
+backend_name();
+
+// work[s] = (x_j[s] - x_i[s] - t) / d, returns max(0, max(work))
+template <typename Real>
+inline double
+scaled_diff_max(const Real* xj, const Real* xi, size_t stride, size_t n, double t, double d, Real* work)
+{
+    return selected<Real>().scaled_diff_max(xj, xi, stride, n, t, d, work);
+}
+
+// work[s] = exp(work[s] - u_max), returns sum(work)
+template <typename Real>
+inline double
+exp_sum(Real* work, size_t n, double u_max)
+{
+    return selected<Real>().exp_sum(work, n, u_max);
+}
+
+// g_j[s] += c * work[s]; g_i[s] -= c * work[s]
+template <typename Real>
+inline void
+scatter(Real* gj, Real* gi, size_t stride, size_t n, const Real* work, double c)
+{
+    selected<Real>().scatter(gj, gi, stride, n, work, c);
+}
+
+// work[s] = x_j[s] - x_i[s] - t, returns max(0, max(work))
+template <typename Real>
+inline double
+diff_max(const Real* xj, const Real* xi, size_t stride, size_t n, double t, Real* work)
+{
+    return selected<Real>().diff_max(xj, xi, stride, n, t, work);
+}
+
+// for all s where work[s] == max: g_j[s] += c; g_i[s] -= c
+template <typename Real>
+inline void
+scatter_max(Real* gj, Real* gi, size_t stride, size_t n, const Real* work, double max, double c)
+{
+    selected<Real>().scatter_max(gj, gi, stride, n, work, max, c);
+}
+
+// work[s] = ((x_j[s] + t * d_j[s]) - (x_i[s] + t * d_i[s]) - te) / d, returns max(0, max(work)).
+// Same as scaled_diff_max() of x + t * d, but the point is not formed.
+template <typename Real>
+inline double
+line_scaled_diff_max(const Real* xj, const Real* xi, const Real* dj, const Real* di, size_t stride, size_t n,
+                     double t, double te, double d, Real* work)
+{
+    return selected<Real>().line_scaled_diff_max(xj, xi, dj, di, stride, n, t, te, d, work);
+}
+
+// Versions of scaled_diff_max() and scatter() for a subset of sources, work[k] corresponds
+// to the source sources[k]. Sources are gathered one by one, so these pay off only when the
+// subset is a small part of all sources.
+
+template <typename Real>
+inline double
+indexed_scaled_diff_max(const Real* xj, const Real* xi, size_t stride, const uint32_t* sources, size_t n,
+                        double t, double d, Real* work)
+{
+    const Real rt = t;
+    const Real rd = d;
+
+    Real u_max = 0.0;
+    for (size_t k = 0; k < n; ++k)
+    {
+        const auto s = sources[k] * stride;
+        work[k] = (xj[s] - xi[s] - rt) / rd;
+        u_max = std::max(u_max, work[k]);
+    }
+
+    return u_max;
+}
+
+template <typename Real>
+inline void
+indexed_scatter(Real* gj, Real* gi, size_t stride, const uint32_t* sources, size_t n, const Real* work, double c)
+{
+    if (gj == gi)
+    {
+        return;
+    }
+
+    const Real rc = c;
+    for (size_t k = 0; k < n; ++k)
+    {
+        const auto s = sources[k] * stride;
+        const auto v = rc * work[k];
+        gj[s] += v;
+        gi[s] -= v;
+    }
+}
+
+// sum(work[s] * (d_j[s] - d_i[s])) in double precision, used by line derivatives only
+template <typename Real>
+inline double
+diff_dot(const Real* work, const Real* dj, const Real* di, size_t stride, size_t n)
+{
+    double sum = 0.0;
+    for (size_t s = 0; s < n; ++s)
+    {
+        sum += double(work[s]) * (double(dj[s * stride]) - double(di[s * stride]));
+    }
+
+    return sum;
+}
+
+}
+
+}
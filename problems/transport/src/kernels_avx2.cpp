@@ -0,0 +1,29 @@
+// Compiled with -mavx2 -mfma, see CMakeLists.txt
+#ifdef T_OPT_BLAS_X86
+
+#define T_OPT_KERNELS_AVX2
+#include "kernels_simd.hpp"
+
+namespace transport
+{
+
+namespace kernels
+{
+
+namespace backend
+{
+
+const Backend*
+avx2_backend()
+{
+    static const Backend backend = make_backend("avx2");
+    return &backend;
+}
+
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,29 @@
+// Compiled with -mavx512f, see CMakeLists.txt
+#ifdef T_OPT_BLAS_X86
+
+#define T_OPT_KERNELS_AVX512
+#include "kernels_simd.hpp"
+
+namespace transport
+{
+
+namespace kernels
+{
+
+namespace backend
+{
+
+const Backend*
+avx512_backend()
+{
+    static const Backend backend = make_backend("avx512");
+    return &backend;
+}
+
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+
+namespace transport
+{
+
+namespace kernels
+{
+
+namespace backend
+{
+
+// Table of the kernels of kernels.hpp for one instruction set and precision
+template <typename Real>
+struct Kernels
+{
+    double (*scaled_diff_max)(const Real* xj, const Real* xi, size_t stride, size_t n, double t, double d, Real* work);
+    double (*exp_sum)(Real* work, size_t n, double u_max);
+    void (*scatter)(Real* gj, Real* gi, size_t stride, size_t n, const Real* work, double c);
+    double (*diff_max)(const Real* xj, const Real* xi, size_t stride, size_t n, double t, Real* work);
+    void (*scatter_max)(Real* gj, Real* gi, size_t stride, size_t n, const Real* work, double max, double c);
+    double (*line_scaled_diff_max)(const Real* xj, const Real* xi, const Real* dj, const Real* di, size_t stride,
+                                   size_t n, double t, double te, double d, Real* work);
+};
+
+struct Backend
+{
+    const char* name;
+
+    Kernels<double> f64;
+    Kernels<float> f32;
+};
+
+const Backend*
+scalar_backend();
+
+// Defined only for x86 targets, must be called only if the host CPU supports them
+const Backend*
+avx2_backend();
+
+const Backend*
+avx512_backend();
+
+}
+
+}
+
+}
@@ -0,0 +1,23 @@
+#include "kernels_simd.hpp"
+
+namespace transport
+{
+
+namespace kernels
+{
+
+namespace backend
+{
+
+const Backend*
+scalar_backend()
+{
+    static const Backend backend = make_backend("scalar");
+    return &backend;
+}
+
+}
+
+}
+
+}
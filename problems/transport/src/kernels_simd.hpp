@@ -0,0 +1,840 @@
+#pragma once
+
+// Bodies of the kernels of kernels.hpp for kernels_*.cpp files, every file defines the macro of its
+// instruction set (T_OPT_KERNELS_AVX2, T_OPT_KERNELS_AVX512 or none for scalar code) and is
+// compiled with the matching flags.
+//
+// Everything here has internal linkage, so code compiled for different instruction sets is never
+// merged by the linker.
+
+#include "kernels_backend.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#if defined(T_OPT_KERNELS_AVX2) || defined(T_OPT_KERNELS_AVX512)
+#include <immintrin.h>
+#endif
+
+// GCC passes undefined vectors to unmasked AVX-512 intrinsics (_mm512_reduce_*, max, scalef...)
+// and warns about them when they are inlined, the warnings are false positives
+#if defined(T_OPT_KERNELS_AVX512) && defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace transport
+{
+
+namespace kernels
+{
+
+namespace backend
+{
+
+namespace
+{
+
+#if defined(T_OPT_KERNELS_AVX512)
+
+inline __m512d
+exp(__m512d x)
+{
+    // exp(x) = 2^n * exp(r), where n = round(x / ln2) and |r| <= ln2 / 2
+    const auto log2e = _mm512_set1_pd(1.4426950408889634074);
+    const auto ln2_hi = _mm512_set1_pd(6.93145751953125e-1);
+    const auto ln2_lo = _mm512_set1_pd(1.42860682030941723212e-6);
+
+    // max/min return their second operand for NaN, so NaN inputs are put back at the end
+    const auto nan = _mm512_cmp_pd_mask(x, x, _CMP_UNORD_Q);
+    const auto x0 = x;
+
+    x = _mm512_max_pd(x, _mm512_set1_pd(-746.0));
+    x = _mm512_min_pd(x, _mm512_set1_pd(709.0));
+
+    const auto n = _mm512_roundscale_pd(_mm512_mul_pd(x, log2e), _MM_FROUND_TO_NEAREST_INT);
+    auto r = _mm512_fnmadd_pd(n, ln2_hi, x);
+    r = _mm512_fnmadd_pd(n, ln2_lo, r);
+
+    // Taylor series up to r^12, truncation error is below 2e-16
+    auto p = _mm512_set1_pd(1.0 / 479001600.0);
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 39916800.0));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 3628800.0));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 362880.0));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 40320.0));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 5040.0));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 720.0));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 120.0));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 24.0));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0 / 6.0));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(0.5));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0));
+
+    return _mm512_mask_mov_pd(_mm512_scalef_pd(p, n), nan, x0);
+}
+
+#elif defined(T_OPT_KERNELS_AVX2)
+
+inline __m256d
+exp(__m256d x)
+{
+    // exp(x) = 2^n * exp(r), where n = round(x / ln2) and |r| <= ln2 / 2
+    const auto log2e = _mm256_set1_pd(1.4426950408889634074);
+    const auto ln2_hi = _mm256_set1_pd(6.93145751953125e-1);
+    const auto ln2_lo = _mm256_set1_pd(1.42860682030941723212e-6);
+
+    // values below -708 are flushed to zero (no subnormal results)
+    const auto underflow = _mm256_cmp_pd(x, _mm256_set1_pd(-708.0), _CMP_LT_OQ);
+
+    // max/min return their second operand for NaN, so NaN inputs are put back at the end
+    const auto nan = _mm256_cmp_pd(x, x, _CMP_UNORD_Q);
+    const auto x0 = x;
+
+    x = _mm256_max_pd(x, _mm256_set1_pd(-708.0));
+    x = _mm256_min_pd(x, _mm256_set1_pd(709.0));
+
+    const auto n = _mm256_round_pd(_mm256_mul_pd(x, log2e), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    auto r = _mm256_fnmadd_pd(n, ln2_hi, x);
+    r = _mm256_fnmadd_pd(n, ln2_lo, r);
+
+    // Taylor series up to r^12, truncation error is below 2e-16
+    auto p = _mm256_set1_pd(1.0 / 479001600.0);
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 39916800.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 3628800.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 362880.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 40320.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 5040.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 720.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 120.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 24.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 6.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(0.5));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0));
+
+    // 2^n is built directly from exponent bits
+    auto e = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n));
+    e = _mm256_slli_epi64(_mm256_add_epi64(e, _mm256_set1_epi64x(1023)), 52);
+
+    return _mm256_blendv_pd(_mm256_andnot_pd(underflow, _mm256_mul_pd(p, _mm256_castsi256_pd(e))), x0, nan);
+}
+
+inline double
+hmax(__m256d v)
+{
+    auto h = _mm_max_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return std::max(_mm_cvtsd_f64(h), _mm_cvtsd_f64(_mm_unpackhi_pd(h, h)));
+}
+
+inline double
+hsum(__m256d v)
+{
+    auto h = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+    return _mm_cvtsd_f64(h) + _mm_cvtsd_f64(_mm_unpackhi_pd(h, h));
+}
+
+#endif
+
+// work[s] = (x_j[s] - x_i[s] - t) / d, returns max(0, max(work))
+inline double
+scaled_diff_max(const double* xj, const double* xi, size_t stride, size_t n, double t, double d, double* work)
+{
+    double u_max = 0.0;
+    size_t s = 0;
+
+    if (stride == 1)
+    {
+#if defined(T_OPT_KERNELS_AVX512)
+        const auto vt = _mm512_set1_pd(t);
+        const auto vd = _mm512_set1_pd(d);
+        auto vmax = _mm512_setzero_pd();
+        for (; s < n; s += 8)
+        {
+            const __mmask8 m = (n - s >= 8) ? 0xFF : (__mmask8)((1u << (n - s)) - 1);
+            auto v = _mm512_sub_pd(_mm512_maskz_loadu_pd(m, xj + s), _mm512_maskz_loadu_pd(m, xi + s));
+            v = _mm512_div_pd(_mm512_sub_pd(v, vt), vd);
+            _mm512_mask_storeu_pd(work + s, m, v);
+            vmax = _mm512_mask_max_pd(vmax, m, vmax, v);
+        }
+        return _mm512_reduce_max_pd(vmax);
+#elif defined(T_OPT_KERNELS_AVX2)
+        const auto vt = _mm256_set1_pd(t);
+        const auto vd = _mm256_set1_pd(d);
+        auto vmax = _mm256_setzero_pd();
+        for (; s + 4 <= n; s += 4)
+        {
+            auto v = _mm256_sub_pd(_mm256_loadu_pd(xj + s), _mm256_loadu_pd(xi + s));
+            v = _mm256_div_pd(_mm256_sub_pd(v, vt), vd);
+            _mm256_storeu_pd(work + s, v);
+            vmax = _mm256_max_pd(vmax, v);
+        }
+        u_max = hmax(vmax);
+#endif
+    }
+
+    for (; s < n; ++s)
+    {
+        work[s] = (xj[s * stride] - xi[s * stride] - t) / d;
+        u_max = std::max(u_max, work[s]);
+    }
+
+    return u_max;
+}
+
+// work[s] = exp(work[s] - u_max), returns sum(work)
+inline double
+exp_sum(double* work, size_t n, double u_max)
+{
+    double sum = 0.0;
+    size_t s = 0;
+
+#if defined(T_OPT_KERNELS_AVX512)
+    const auto vu = _mm512_set1_pd(u_max);
+    auto vsum = _mm512_setzero_pd();
+    for (; s < n; s += 8)
+    {
+        const __mmask8 m = (n - s >= 8) ? 0xFF : (__mmask8)((1u << (n - s)) - 1);
+        const auto v = exp(_mm512_sub_pd(_mm512_maskz_loadu_pd(m, work + s), vu));
+        _mm512_mask_storeu_pd(work + s, m, v);
+        vsum = _mm512_mask_add_pd(vsum, m, vsum, v);
+    }
+    return _mm512_reduce_add_pd(vsum);
+#elif defined(T_OPT_KERNELS_AVX2)
+    const auto vu = _mm256_set1_pd(u_max);
+    auto vsum = _mm256_setzero_pd();
+    for (; s + 4 <= n; s += 4)
+    {
+        const auto v = exp(_mm256_sub_pd(_mm256_loadu_pd(work + s), vu));
+        _mm256_storeu_pd(work + s, v);
+        vsum = _mm256_add_pd(vsum, v);
+    }
+    sum = hsum(vsum);
+#endif
+
+    for (; s < n; ++s)
+    {
+        work[s] = std::exp(work[s] - u_max);
+        sum += work[s];
+    }
+
+    return sum;
+}
+
+// g_j[s] += c * work[s]; g_i[s] -= c * work[s]
+inline void
+scatter(double* gj, double* gi, size_t stride, size_t n, const double* work, double c)
+{
+    if (gj == gi)
+    {
+        // loop edge, contributions are cancelled
+        return;
+    }
+
+    size_t s = 0;
+
+    if (stride == 1)
+    {
+#if defined(T_OPT_KERNELS_AVX512)
+        const auto vc = _mm512_set1_pd(c);
+        for (; s < n; s += 8)
+        {
+            const __mmask8 m = (n - s >= 8) ? 0xFF : (__mmask8)((1u << (n - s)) - 1);
+            const auto v = _mm512_mul_pd(vc, _mm512_maskz_loadu_pd(m, work + s));
+            _mm512_mask_storeu_pd(gj + s, m, _mm512_add_pd(_mm512_maskz_loadu_pd(m, gj + s), v));
+            _mm512_mask_storeu_pd(gi + s, m, _mm512_sub_pd(_mm512_maskz_loadu_pd(m, gi + s), v));
+        }
+#elif defined(T_OPT_KERNELS_AVX2)
+        const auto vc = _mm256_set1_pd(c);
+        for (; s + 4 <= n; s += 4)
+        {
+            const auto v = _mm256_mul_pd(vc, _mm256_loadu_pd(work + s));
+            _mm256_storeu_pd(gj + s, _mm256_add_pd(_mm256_loadu_pd(gj + s), v));
+            _mm256_storeu_pd(gi + s, _mm256_sub_pd(_mm256_loadu_pd(gi + s), v));
+        }
+#endif
+    }
+
+    for (; s < n; ++s)
+    {
+        const auto v = c * work[s];
+        gj[s * stride] += v;
+        gi[s * stride] -= v;
+    }
+}
+
+// work[s] = x_j[s] - x_i[s] - t, returns max(0, max(work))
+inline double
+diff_max(const double* xj, const double* xi, size_t stride, size_t n, double t, double* work)
+{
+    double max = 0.0;
+    size_t s = 0;
+
+    if (stride == 1)
+    {
+#if defined(T_OPT_KERNELS_AVX512)
+        const auto vt = _mm512_set1_pd(t);
+        auto vmax = _mm512_setzero_pd();
+        for (; s < n; s += 8)
+        {
+            const __mmask8 m = (n - s >= 8) ? 0xFF : (__mmask8)((1u << (n - s)) - 1);
+            auto v = _mm512_sub_pd(_mm512_maskz_loadu_pd(m, xj + s), _mm512_maskz_loadu_pd(m, xi + s));
+            v = _mm512_sub_pd(v, vt);
+            _mm512_mask_storeu_pd(work + s, m, v);
+            vmax = _mm512_mask_max_pd(vmax, m, vmax, v);
+        }
+        return _mm512_reduce_max_pd(vmax);
+#elif defined(T_OPT_KERNELS_AVX2)
+        const auto vt = _mm256_set1_pd(t);
+        auto vmax = _mm256_setzero_pd();
+        for (; s + 4 <= n; s += 4)
+        {
+            auto v = _mm256_sub_pd(_mm256_loadu_pd(xj + s), _mm256_loadu_pd(xi + s));
+            v = _mm256_sub_pd(v, vt);
+            _mm256_storeu_pd(work + s, v);
+            vmax = _mm256_max_pd(vmax, v);
+        }
+        max = hmax(vmax);
+#endif
+    }
+
+    for (; s < n; ++s)
+    {
+        work[s] = xj[s * stride] - xi[s * stride] - t;
+        max = std::max(max, work[s]);
+    }
+
+    return max;
+}
+
+// for all s where work[s] == max: g_j[s] += c; g_i[s] -= c
+inline void
+scatter_max(double* gj, double* gi, size_t stride, size_t n, const double* work, double max, double c)
+{
+    if (gj == gi)
+    {
+        return;
+    }
+
+    size_t s = 0;
+
+    if (stride == 1)
+    {
+#if defined(T_OPT_KERNELS_AVX512)
+        const auto vmax = _mm512_set1_pd(max);
+        const auto vc = _mm512_set1_pd(c);
+        for (; s < n; s += 8)
+        {
+            const __mmask8 m = (n - s >= 8) ? 0xFF : (__mmask8)((1u << (n - s)) - 1);
+            const auto eq = _mm512_mask_cmp_pd_mask(m, _mm512_maskz_loadu_pd(m, work + s), vmax, _CMP_EQ_OQ);
+            if (eq != 0)
+            {
+                _mm512_mask_storeu_pd(gj + s, eq, _mm512_add_pd(_mm512_maskz_loadu_pd(eq, gj + s), vc));
+                _mm512_mask_storeu_pd(gi + s, eq, _mm512_sub_pd(_mm512_maskz_loadu_pd(eq, gi + s), vc));
+            }
+        }
+#elif defined(T_OPT_KERNELS_AVX2)
+        const auto vmax = _mm256_set1_pd(max);
+        const auto vc = _mm256_set1_pd(c);
+        for (; s + 4 <= n; s += 4)
+        {
+            const auto eq = _mm256_cmp_pd(_mm256_loadu_pd(work + s), vmax, _CMP_EQ_OQ);
+            if (_mm256_movemask_pd(eq) != 0)
+            {
+                const auto v = _mm256_and_pd(eq, vc);
+                _mm256_storeu_pd(gj + s, _mm256_add_pd(_mm256_loadu_pd(gj + s), v));
+                _mm256_storeu_pd(gi + s, _mm256_sub_pd(_mm256_loadu_pd(gi + s), v));
+            }
+        }
+#endif
+    }
+
+    for (; s < n; ++s)
+    {
+        if (work[s] == max)
+        {
+            gj[s * stride] += c;
+            gi[s * stride] -= c;
+        }
+    }
+}
+
+// work[s] = ((x_j[s] + t * d_j[s]) - (x_i[s] + t * d_i[s]) - te) / d, returns max(0, max(work)).
+// Same as scaled_diff_max() of x + t * d, but the point is not formed.
+inline double
+line_scaled_diff_max(const double* xj, const double* xi, const double* dj, const double* di, size_t stride, size_t n,
+                     double t, double te, double d, double* work)
+{
+    double u_max = 0.0;
+    size_t s = 0;
+
+    if (stride == 1)
+    {
+#if defined(T_OPT_KERNELS_AVX512)
+        const auto vs = _mm512_set1_pd(t);
+        const auto vt = _mm512_set1_pd(te);
+        const auto vd = _mm512_set1_pd(d);
+        auto vmax = _mm512_setzero_pd();
+        for (; s < n; s += 8)
+        {
+            const __mmask8 m = (n - s >= 8) ? 0xFF : (__mmask8)((1u << (n - s)) - 1);
+            const auto vj = _mm512_fmadd_pd(vs, _mm512_maskz_loadu_pd(m, dj + s), _mm512_maskz_loadu_pd(m, xj + s));
+            const auto vi = _mm512_fmadd_pd(vs, _mm512_maskz_loadu_pd(m, di + s), _mm512_maskz_loadu_pd(m, xi + s));
+            const auto v = _mm512_div_pd(_mm512_sub_pd(_mm512_sub_pd(vj, vi), vt), vd);
+            _mm512_mask_storeu_pd(work + s, m, v);
+            vmax = _mm512_mask_max_pd(vmax, m, vmax, v);
+        }
+        return _mm512_reduce_max_pd(vmax);
+#elif defined(T_OPT_KERNELS_AVX2)
+        const auto vs = _mm256_set1_pd(t);
+        const auto vt = _mm256_set1_pd(te);
+        const auto vd = _mm256_set1_pd(d);
+        auto vmax = _mm256_setzero_pd();
+        for (; s + 4 <= n; s += 4)
+        {
+            const auto vj = _mm256_fmadd_pd(vs, _mm256_loadu_pd(dj + s), _mm256_loadu_pd(xj + s));
+            const auto vi = _mm256_fmadd_pd(vs, _mm256_loadu_pd(di + s), _mm256_loadu_pd(xi + s));
+            const auto v = _mm256_div_pd(_mm256_sub_pd(_mm256_sub_pd(vj, vi), vt), vd);
+            _mm256_storeu_pd(work + s, v);
+            vmax = _mm256_max_pd(vmax, v);
+        }
+        u_max = hmax(vmax);
+#endif
+    }
+
+    for (; s < n; ++s)
+    {
+        const auto vj = t * dj[s * stride] + xj[s * stride];
+        const auto vi = t * di[s * stride] + xi[s * stride];
+        work[s] = (vj - vi - te) / d;
+        u_max = std::max(u_max, work[s]);
+    }
+
+    return u_max;
+}
+
+// Single precision versions of the kernels above, used by float problems. Vectors hold twice
+// as many sources, exp() is accurate to a few float ulps.
+
+#if defined(T_OPT_KERNELS_AVX512)
+
+inline __m512
+exp(__m512 x)
+{
+    const auto log2e = _mm512_set1_ps(1.44269504f);
+    const auto ln2_hi = _mm512_set1_ps(6.93359375e-1f);
+    const auto ln2_lo = _mm512_set1_ps(-2.12194440e-4f);
+
+    // max/min return their second operand for NaN, so NaN inputs are put back at the end
+    const auto nan = _mm512_cmp_ps_mask(x, x, _CMP_UNORD_Q);
+    const auto x0 = x;
+
+    x = _mm512_max_ps(x, _mm512_set1_ps(-104.0f));
+    x = _mm512_min_ps(x, _mm512_set1_ps(88.0f));
+
+    const auto n = _mm512_roundscale_ps(_mm512_mul_ps(x, log2e), _MM_FROUND_TO_NEAREST_INT);
+    auto r = _mm512_fnmadd_ps(n, ln2_hi, x);
+    r = _mm512_fnmadd_ps(n, ln2_lo, r);
+
+    // Taylor series up to r^7, truncation error is below 1e-8
+    auto p = _mm512_set1_ps(1.0f / 5040.0f);
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.0f / 720.0f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.0f / 120.0f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.0f / 24.0f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.0f / 6.0f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(0.5f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.0f));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(1.0f));
+
+    return _mm512_mask_mov_ps(_mm512_scalef_ps(p, n), nan, x0);
+}
+
+#elif defined(T_OPT_KERNELS_AVX2)
+
+inline __m256
+exp(__m256 x)
+{
+    const auto log2e = _mm256_set1_ps(1.44269504f);
+    const auto ln2_hi = _mm256_set1_ps(6.93359375e-1f);
+    const auto ln2_lo = _mm256_set1_ps(-2.12194440e-4f);
+
+    // values below -87 are flushed to zero (no subnormal results)
+    const auto underflow = _mm256_cmp_ps(x, _mm256_set1_ps(-87.0f), _CMP_LT_OQ);
+
+    // max/min return their second operand for NaN, so NaN inputs are put back at the end
+    const auto nan = _mm256_cmp_ps(x, x, _CMP_UNORD_Q);
+    const auto x0 = x;
+
+    x = _mm256_max_ps(x, _mm256_set1_ps(-87.0f));
+    x = _mm256_min_ps(x, _mm256_set1_ps(88.0f));
+
+    const auto n = _mm256_round_ps(_mm256_mul_ps(x, log2e), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    auto r = _mm256_fnmadd_ps(n, ln2_hi, x);
+    r = _mm256_fnmadd_ps(n, ln2_lo, r);
+
+    // Taylor series up to r^7, truncation error is below 1e-8
+    auto p = _mm256_set1_ps(1.0f / 5040.0f);
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.0f / 720.0f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.0f / 120.0f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.0f / 24.0f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.0f / 6.0f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(0.5f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.0f));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.0f));
+
+    // 2^n is built directly from exponent bits
+    auto e = _mm256_cvtps_epi32(n);
+    e = _mm256_slli_epi32(_mm256_add_epi32(e, _mm256_set1_epi32(127)), 23);
+
+    return _mm256_blendv_ps(_mm256_andnot_ps(underflow, _mm256_mul_ps(p, _mm256_castsi256_ps(e))), x0, nan);
+}
+
+inline float
+hmax(__m256 v)
+{
+    auto h = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    h = _mm_max_ps(h, _mm_movehl_ps(h, h));
+    return std::max(_mm_cvtss_f32(h), _mm_cvtss_f32(_mm_shuffle_ps(h, h, 1)));
+}
+
+inline float
+hsum(__m256 v)
+{
+    auto h = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    h = _mm_add_ps(h, _mm_movehl_ps(h, h));
+    return _mm_cvtss_f32(h) + _mm_cvtss_f32(_mm_shuffle_ps(h, h, 1));
+}
+
+#endif
+
+#if defined(T_OPT_KERNELS_AVX512)
+
+inline __mmask16
+tail_mask(size_t n, size_t s)
+{
+    return (n - s >= 16) ? 0xFFFF : (__mmask16)((1u << (n - s)) - 1);
+}
+
+#endif
+
+inline double
+scaled_diff_max(const float* xj, const float* xi, size_t stride, size_t n, double t, double d, float* work)
+{
+    float u_max = 0.0f;
+    size_t s = 0;
+
+    if (stride == 1)
+    {
+#if defined(T_OPT_KERNELS_AVX512)
+        const auto vt = _mm512_set1_ps(t);
+        const auto vd = _mm512_set1_ps(d);
+        auto vmax = _mm512_setzero_ps();
+        for (; s < n; s += 16)
+        {
+            const auto m = tail_mask(n, s);
+            auto v = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, xj + s), _mm512_maskz_loadu_ps(m, xi + s));
+            v = _mm512_div_ps(_mm512_sub_ps(v, vt), vd);
+            _mm512_mask_storeu_ps(work + s, m, v);
+            vmax = _mm512_mask_max_ps(vmax, m, vmax, v);
+        }
+        return _mm512_reduce_max_ps(vmax);
+#elif defined(T_OPT_KERNELS_AVX2)
+        const auto vt = _mm256_set1_ps(t);
+        const auto vd = _mm256_set1_ps(d);
+        auto vmax = _mm256_setzero_ps();
+        for (; s + 8 <= n; s += 8)
+        {
+            auto v = _mm256_sub_ps(_mm256_loadu_ps(xj + s), _mm256_loadu_ps(xi + s));
+            v = _mm256_div_ps(_mm256_sub_ps(v, vt), vd);
+            _mm256_storeu_ps(work + s, v);
+            vmax = _mm256_max_ps(vmax, v);
+        }
+        u_max = hmax(vmax);
+#endif
+    }
+
+    const float ft = t;
+    const float fd = d;
+    for (; s < n; ++s)
+    {
+        work[s] = (xj[s * stride] - xi[s * stride] - ft) / fd;
+        u_max = std::max(u_max, work[s]);
+    }
+
+    return u_max;
+}
+
+inline double
+exp_sum(float* work, size_t n, double u_max)
+{
+    float sum = 0.0f;
+    size_t s = 0;
+
+#if defined(T_OPT_KERNELS_AVX512)
+    const auto vu = _mm512_set1_ps(u_max);
+    auto vsum = _mm512_setzero_ps();
+    for (; s < n; s += 16)
+    {
+        const auto m = tail_mask(n, s);
+        const auto v = exp(_mm512_sub_ps(_mm512_maskz_loadu_ps(m, work + s), vu));
+        _mm512_mask_storeu_ps(work + s, m, v);
+        vsum = _mm512_mask_add_ps(vsum, m, vsum, v);
+    }
+    return _mm512_reduce_add_ps(vsum);
+#elif defined(T_OPT_KERNELS_AVX2)
+    const auto vu = _mm256_set1_ps(u_max);
+    auto vsum = _mm256_setzero_ps();
+    for (; s + 8 <= n; s += 8)
+    {
+        const auto v = exp(_mm256_sub_ps(_mm256_loadu_ps(work + s), vu));
+        _mm256_storeu_ps(work + s, v);
+        vsum = _mm256_add_ps(vsum, v);
+    }
+    sum = hsum(vsum);
+#endif
+
+    const float fu = u_max;
+    for (; s < n; ++s)
+    {
+        work[s] = std::exp(work[s] - fu);
+        sum += work[s];
+    }
+
+    return sum;
+}
+
+inline void
+scatter(float* gj, float* gi, size_t stride, size_t n, const float* work, double c)
+{
+    if (gj == gi)
+    {
+        return;
+    }
+
+    size_t s = 0;
+
+    if (stride == 1)
+    {
+#if defined(T_OPT_KERNELS_AVX512)
+        const auto vc = _mm512_set1_ps(c);
+        for (; s < n; s += 16)
+        {
+            const auto m = tail_mask(n, s);
+            const auto v = _mm512_mul_ps(vc, _mm512_maskz_loadu_ps(m, work + s));
+            _mm512_mask_storeu_ps(gj + s, m, _mm512_add_ps(_mm512_maskz_loadu_ps(m, gj + s), v));
+            _mm512_mask_storeu_ps(gi + s, m, _mm512_sub_ps(_mm512_maskz_loadu_ps(m, gi + s), v));
+        }
+#elif defined(T_OPT_KERNELS_AVX2)
+        const auto vc = _mm256_set1_ps(c);
+        for (; s + 8 <= n; s += 8)
+        {
+            const auto v = _mm256_mul_ps(vc, _mm256_loadu_ps(work + s));
+            _mm256_storeu_ps(gj + s, _mm256_add_ps(_mm256_loadu_ps(gj + s), v));
+            _mm256_storeu_ps(gi + s, _mm256_sub_ps(_mm256_loadu_ps(gi + s), v));
+        }
+#endif
+    }
+
+    const float fc = c;
+    for (; s < n; ++s)
+    {
+        const auto v = fc * work[s];
+        gj[s * stride] += v;
+        gi[s * stride] -= v;
+    }
+}
+
+inline double
+diff_max(const float* xj, const float* xi, size_t stride, size_t n, double t, float* work)
+{
+    float max = 0.0f;
+    size_t s = 0;
+
+    if (stride == 1)
+    {
+#if defined(T_OPT_KERNELS_AVX512)
+        const auto vt = _mm512_set1_ps(t);
+        auto vmax = _mm512_setzero_ps();
+        for (; s < n; s += 16)
+        {
+            const auto m = tail_mask(n, s);
+            auto v = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, xj + s), _mm512_maskz_loadu_ps(m, xi + s));
+            v = _mm512_sub_ps(v, vt);
+            _mm512_mask_storeu_ps(work + s, m, v);
+            vmax = _mm512_mask_max_ps(vmax, m, vmax, v);
+        }
+        return _mm512_reduce_max_ps(vmax);
+#elif defined(T_OPT_KERNELS_AVX2)
+        const auto vt = _mm256_set1_ps(t);
+        auto vmax = _mm256_setzero_ps();
+        for (; s + 8 <= n; s += 8)
+        {
+            auto v = _mm256_sub_ps(_mm256_loadu_ps(xj + s), _mm256_loadu_ps(xi + s));
+            v = _mm256_sub_ps(v, vt);
+            _mm256_storeu_ps(work + s, v);
+            vmax = _mm256_max_ps(vmax, v);
+        }
+        max = hmax(vmax);
+#endif
+    }
+
+    const float ft = t;
+    for (; s < n; ++s)
+    {
+        work[s] = xj[s * stride] - xi[s * stride] - ft;
+        max = std::max(max, work[s]);
+    }
+
+    return max;
+}
+
+inline void
+scatter_max(float* gj, float* gi, size_t stride, size_t n, const float* work, double max, double c)
+{
+    if (gj == gi)
+    {
+        return;
+    }
+
+    size_t s = 0;
+    const float fmax = max;
+    const float fc = c;
+
+    if (stride == 1)
+    {
+#if defined(T_OPT_KERNELS_AVX512)
+        const auto vmax = _mm512_set1_ps(fmax);
+        const auto vc = _mm512_set1_ps(fc);
+        for (; s < n; s += 16)
+        {
+            const auto m = tail_mask(n, s);
+            const auto eq = _mm512_mask_cmp_ps_mask(m, _mm512_maskz_loadu_ps(m, work + s), vmax, _CMP_EQ_OQ);
+            if (eq != 0)
+            {
+                _mm512_mask_storeu_ps(gj + s, eq, _mm512_add_ps(_mm512_maskz_loadu_ps(eq, gj + s), vc));
+                _mm512_mask_storeu_ps(gi + s, eq, _mm512_sub_ps(_mm512_maskz_loadu_ps(eq, gi + s), vc));
+            }
+        }
+#elif defined(T_OPT_KERNELS_AVX2)
+        const auto vmax = _mm256_set1_ps(fmax);
+        const auto vc = _mm256_set1_ps(fc);
+        for (; s + 8 <= n; s += 8)
+        {
+            const auto eq = _mm256_cmp_ps(_mm256_loadu_ps(work + s), vmax, _CMP_EQ_OQ);
+            if (_mm256_movemask_ps(eq) != 0)
+            {
+                const auto v = _mm256_and_ps(eq, vc);
+                _mm256_storeu_ps(gj + s, _mm256_add_ps(_mm256_loadu_ps(gj + s), v));
+                _mm256_storeu_ps(gi + s, _mm256_sub_ps(_mm256_loadu_ps(gi + s), v));
+            }
+        }
+#endif
+    }
+
+    for (; s < n; ++s)
+    {
+        if (work[s] == fmax)
+        {
+            gj[s * stride] += fc;
+            gi[s * stride] -= fc;
+        }
+    }
+}
+
+inline double
+line_scaled_diff_max(const float* xj, const float* xi, const float* dj, const float* di, size_t stride, size_t n,
+                     double t, double te, double d, float* work)
+{
+    float u_max = 0.0f;
+    size_t s = 0;
+
+    if (stride == 1)
+    {
+#if defined(T_OPT_KERNELS_AVX512)
+        const auto vs = _mm512_set1_ps(t);
+        const auto vt = _mm512_set1_ps(te);
+        const auto vd = _mm512_set1_ps(d);
+        auto vmax = _mm512_setzero_ps();
+        for (; s < n; s += 16)
+        {
+            const auto m = tail_mask(n, s);
+            const auto vj = _mm512_fmadd_ps(vs, _mm512_maskz_loadu_ps(m, dj + s), _mm512_maskz_loadu_ps(m, xj + s));
+            const auto vi = _mm512_fmadd_ps(vs, _mm512_maskz_loadu_ps(m, di + s), _mm512_maskz_loadu_ps(m, xi + s));
+            const auto v = _mm512_div_ps(_mm512_sub_ps(_mm512_sub_ps(vj, vi), vt), vd);
+            _mm512_mask_storeu_ps(work + s, m, v);
+            vmax = _mm512_mask_max_ps(vmax, m, vmax, v);
+        }
+        return _mm512_reduce_max_ps(vmax);
+#elif defined(T_OPT_KERNELS_AVX2)
+        const auto vs = _mm256_set1_ps(t);
+        const auto vt = _mm256_set1_ps(te);
+        const auto vd = _mm256_set1_ps(d);
+        auto vmax = _mm256_setzero_ps();
+        for (; s + 8 <= n; s += 8)
+        {
+            const auto vj = _mm256_fmadd_ps(vs, _mm256_loadu_ps(dj + s), _mm256_loadu_ps(xj + s));
+            const auto vi = _mm256_fmadd_ps(vs, _mm256_loadu_ps(di + s), _mm256_loadu_ps(xi + s));
+            const auto v = _mm256_div_ps(_mm256_sub_ps(_mm256_sub_ps(vj, vi), vt), vd);
+            _mm256_storeu_ps(work + s, v);
+            vmax = _mm256_max_ps(vmax, v);
+        }
+        u_max = hmax(vmax);
+#endif
+    }
+
+    const float ft = t;
+    const float fte = te;
+    const float fd = d;
+    for (; s < n; ++s)
+    {
+        const auto vj = ft * dj[s * stride] + xj[s * stride];
+        const auto vi = ft * di[s * stride] + xi[s * stride];
+        work[s] = (vj - vi - fte) / fd;
+        u_max = std::max(u_max, work[s]);
+    }
+
+    return u_max;
+}
+
+// Takes the kernels above, compiled for the instruction set of the including file
+template <typename Real>
+Kernels<Real>
+make_kernels()
+{
+    Kernels<Real> k;
+
+    k.scaled_diff_max = &scaled_diff_max;
+    k.exp_sum = &exp_sum;
+    k.scatter = &scatter;
+    k.diff_max = &diff_max;
+    k.scatter_max = &scatter_max;
+    k.line_scaled_diff_max = &line_scaled_diff_max;
+
+    return k;
+}
+
+Backend
+make_backend(const char* name)
+{
+    Backend b;
+
+    b.name = name;
+    b.f64 = make_kernels<double>();
+    b.f32 = make_kernels<float>();
+
+    return b;
+}
+
+}
+
+}
+
+}
+
+}
+
+#if defined(T_OPT_KERNELS_AVX512) && defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
@@ -1,20 +1,43 @@
 #include "sdm.hpp"
 
+#include "kernels.hpp"
+
 #include "core/chrono.hpp"
 
+#include <algorithm>
+
 namespace transport
 {
 
-SDM::SDM(const String& problem_name, const String& data_path, const String& data_name)
+template <typename Real>
+BasicSDM<Real>::BasicSDM(const String& problem_name, const String& data_path, const String& data_name, Layout layout)
     : Problem(problem_name, 0, ProblemProperty::Gradient) // pass 0 as size, real size will be calculated later
+    , layout(layout)
+    , line_x(nullptr)
+    , line_dir(nullptr)
 {
     auto time_0 = chrono::now();
     tntp::load_tntp_data(data_path, data_name, data);
     auto time_i = chrono::s(time_0);
     printf("Load time = %.4f s.\n", time_i);
 
-    // FIXME we need sparse problem instead
-    m_size = data.max_node_index * data.max_node_index;
+    build_index();
+
+    // only source rows of potentials are used, so store them as compact sources x nodes matrix
+    this->m_size = data.sources.size() * nodes_count;
+
+    switch (layout)
+    {
+        case Layout::SourceMajor:
+            row_stride = nodes_count;
+            column_stride = 1;
+            break;
+
+        case Layout::NodeMajor:
+            row_stride = 1;
+            column_stride = data.sources.size();
+            break;
+    }
 
     // FIXME
 
@@ -25,8 +48,9 @@ SDM::SDM(const String& problem_name, const String& data_path, const String& data
     work.resize(data.sources.size());
 }
 
+template <typename Real>
 void
-SDM::apply_flow(double k, bool use_max)
+BasicSDM<Real>::apply_flow(double k, bool use_max)
 {
     if ((size_t)data.flow.size() == (size_t)data.edges.size())
     {
@@ -45,8 +69,9 @@ SDM::apply_flow(double k, bool use_max)
     }
 }
 
+template <typename Real>
 void
-SDM::apply_total_flow(double k)
+BasicSDM<Real>::apply_total_flow(double k)
 {
     for (auto& e : data.edges)
     {
@@ -56,28 +81,162 @@ SDM::apply_total_flow(double k)
     printf("total flow applied with k = %g\n", k);
 }
 
-std::pair<double, double>
-SDM::calc_exp_sum(const DVector& x, const tntp::Edge& edge, double mu)
+template <typename Real>
+constexpr uint32_t BasicSDM<Real>::NO_COLUMN;
+
+template <typename Real>
+void
+BasicSDM<Real>::build_index()
+{
+    // dense node index keeps columns in the same order as node indices
+    static_assert(NO_COLUMN == tntp::NO_NODE, "absent nodes should be marked in the same way");
+    node_column = data.node_index;
+    nodes_count = data.nodes_count;
+
+    std::vector<uint32_t> source_row(data.max_node_index + 1, NO_COLUMN);
+    source_column.resize(data.sources.size());
+    for (uint32_t s = 0; s < data.sources.size(); ++s)
+    {
+        source_row[data.sources[s]] = s;
+        source_column[s] = node_column[data.sources[s]];
+    }
+
+    edge_index.resize(data.edges.size());
+    for (size_t e = 0; e < data.edges.size(); ++e)
+    {
+        edge_index[e].source = node_column[data.edges[e].source];
+        edge_index[e].target = node_column[data.edges[e].target];
+    }
+
+    trip_index.resize(data.trips.size());
+    for (size_t t = 0; t < data.trips.size(); ++t)
+    {
+        trip_index[t].row = source_row[data.trips[t].source];
+        trip_index[t].source = node_column[data.trips[t].source];
+        trip_index[t].target = node_column[data.trips[t].target];
+    }
+}
+
+template <typename Real>
+void
+BasicSDM<Real>::expand(const Vector<Real>& v, Vector<Real>& plain) const
+{
+    const size_t n = data.max_node_index;
+
+    plain.resize(n * n);
+    plain.setZero();
+
+    for (uint32_t s = 0; s < data.sources.size(); ++s)
+    {
+        const auto i = data.sources[s];
+        for (uint32_t j = 1; j <= data.max_node_index; ++j)
+        {
+            if (node_column[j] != NO_COLUMN)
+            {
+                plain[(i - 1) * n + j - 1] = T(v, s, node_column[j]);
+            }
+        }
+    }
+}
+
+template <typename Real>
+void
+BasicSDM<Real>::set_threads(size_t threads, bool pin)
 {
-    auto u_max = 0.0; // we should fix only big POSITIVE value from exp(value)
+    Problem::set_threads(threads, pin);
 
-    size_t i = 0;
-    for (auto s : data.sources)
+    thread_work.resize(0);
+    if (this->threads() > 1)
     {
-        work[i] = (T(x, s, edge.target) - T(x, s, edge.source) - edge.free_flow_time) / (edge.free_flow_time * mu);
-        u_max = std::max(u_max, work[i]);
-        ++i;
+        thread_work.resize(this->threads(), Vector<Real>(data.sources.size()));
     }
+}
 
-    auto exp_sum = 0.0;
-    for (size_t i = 0; i < data.sources.size(); ++i)
+template <typename Real>
+void
+BasicSDM<Real>::set_zero_rows(Vector<Real>& v, size_t s, size_t count) const
+{
+    switch (layout)
     {
-        work[i] = std::exp(work[i] - u_max);
-        exp_sum += work[i];
+        case Layout::SourceMajor:
+            std::fill_n(&v[s * row_stride], count * nodes_count, 0.0);
+            break;
+
+        case Layout::NodeMajor:
+            for (uint32_t j = 0; j < nodes_count; ++j)
+            {
+                std::fill_n(&v[s * row_stride + j * column_stride], count, 0.0);
+            }
+            break;
     }
+}
+
+template <typename Real>
+std::pair<double, double>
+BasicSDM<Real>::calc_exp_sum(const Vector<Real>& x, size_t e, double mu)
+{
+    return calc_exp_sum(x, e, mu, work.data());
+}
+
+template <typename Real>
+std::pair<double, double>
+BasicSDM<Real>::calc_exp_sum(const Vector<Real>& x, size_t e, double mu, Real* work) const
+{
+    const auto& edge = data.edges[e];
+    const auto i = edge_index[e].source;
+    const auto j = edge_index[e].target;
+
+    // we should fix only big POSITIVE value from exp(value)
+    const auto u_max = kernels::scaled_diff_max(
+        &T(x, 0, j), &T(x, 0, i), row_stride, data.sources.size(),
+        edge.free_flow_time, edge.free_flow_time * mu,
+        work);
+
+    auto exp_sum = kernels::exp_sum(work, data.sources.size(), u_max);
     exp_sum += std::exp(-u_max);
 
     return std::make_pair(u_max, exp_sum);
 }
 
+template <typename Real>
+void
+BasicSDM<Real>::setup_line(const Vector<Real>& x, const Vector<Real>& dir)
+{
+    line_x = &x;
+    line_dir = &dir;
+}
+
+template <typename Real>
+double
+BasicSDM<Real>::line_trips_f(double t, double* dphi) const
+{
+    const auto& x = *line_x;
+    const auto& dir = *line_dir;
+    const Real rt = t;
+
+    double f = 0.0;
+    double df = 0.0;
+    for (size_t k = 0; k < data.trips.size(); ++k)
+    {
+        const auto& trip = trip_index[k];
+        const auto d = data.trips[k].flow;
+
+        const Real target = rt * T(dir, trip.row, trip.target) + T(x, trip.row, trip.target);
+        const Real source = rt * T(dir, trip.row, trip.source) + T(x, trip.row, trip.source);
+
+        f -= d * (target - source);
+        df -= d * (T(dir, trip.row, trip.target) - T(dir, trip.row, trip.source));
+    }
+
+    if (dphi)
+    {
+        *dphi = df;
+    }
+
+    return f;
+}
+
+template struct BasicSDM<double>;
+template struct BasicSDM<float>;
+
 }
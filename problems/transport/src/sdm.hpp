@@ -1,16 +1,34 @@
 #pragma once
 
 #include "core/problem.hpp"
+#include "core/thread_pool.hpp"
 #include "tntp.hpp"
 
+#include <memory>
+
 namespace transport
 {
 
 using namespace t_opt;
 
-struct SDM : public Problem
+// Memory layout of compact potentials matrix
+enum class Layout : uint8_t
+{
+    // all nodes of one source are contiguous
+    SourceMajor,
+
+    // all sources of one node are contiguous, per edge loops over sources are vectorized
+    NodeMajor,
+};
+
+// Real is a scalar type of potentials (double or float), T() is used for potentials access
+template <typename Real>
+struct BasicSDM : public BasicProblem<Real>
 {
-    SDM(const String& problem_name, const String& data_path, const String& data_name);
+    using Point = BasicPoint<Real>;
+    using Problem = BasicProblem<Real>;
+
+    BasicSDM(const String& problem_name, const String& data_path, const String& data_name, Layout layout);
 
     void
     apply_flow(double k, bool use_max = true);
@@ -18,26 +36,94 @@ struct SDM : public Problem
     void
     apply_total_flow(double k);
 
+    // Converts potentials from the compact (sources x nodes) layout into the plain
+    // (max_node_index x max_node_index) one, where T_ij is placed at (i - 1) * max_node_index + j - 1
+    void
+    expand(const Vector<Real>& v, Vector<Real>& plain) const;
+
+    // Also allocates per-thread work buffers
+    void
+    set_threads(size_t threads, bool pin = false) override;
+
 protected:
-    inline double&
-    T(DVector& v, uint32_t i, uint32_t j)
+    // Edge end points as compact node (column) indices
+    struct EdgeIndex
+    {
+        uint32_t source;
+        uint32_t target;
+    };
+
+    // Trip source row and trip end points as compact node (column) indices
+    struct TripIndex
     {
-        // i and j are come from edges which has 1 as start value, but we (C++) uses 0 as start index
-        return v[(i - 1) * data.max_node_index + j - 1];
+        uint32_t row;
+        uint32_t source;
+        uint32_t target;
+    };
+
+    // s is a source (row) index in [0, sources.size()), j is a compact node (column) index
+    inline Real&
+    T(Vector<Real>& v, uint32_t s, uint32_t j)
+    {
+        return v[s * row_stride + j * column_stride];
     }
 
-    inline const double&
-    T(const DVector& v, uint32_t i, uint32_t j)
+    inline const Real&
+    T(const Vector<Real>& v, uint32_t s, uint32_t j) const
     {
-        // i and j are come from edges which has 1 as start value, but we (C++) uses 0 as start index
-        return v[(i - 1) * data.max_node_index + j - 1];
+        return v[s * row_stride + j * column_stride];
     }
 
+    // Sets rows [s, s + count) of v to zero, used by df() to clear only rows of the current thread
+    void
+    set_zero_rows(Vector<Real>& v, size_t s, size_t count) const;
+
+    std::pair<double, double>
+    calc_exp_sum(const Vector<Real>& x, size_t e, double mu);
+
+    // Same as above, but uses external work buffer (safe to call from pool threads)
     std::pair<double, double>
-    calc_exp_sum(const DVector& x, const tntp::Edge& edge, double mu);
+    calc_exp_sum(const Vector<Real>& x, size_t e, double mu, Real* work) const;
+
+    // Remembers x and dir for line_f() of derived problems, which evaluate x + t * dir without
+    // forming it. Both should stay unchanged while the line is evaluated (a line search).
+    void
+    setup_line(const Vector<Real>& x, const Vector<Real>& dir);
+
+    // Trips part of f at x + t * dir, its derivative by t is written into dphi if it's not null
+    double
+    line_trips_f(double t, double* dphi) const;
 
     tntp::Data data;
-    DVector work;
+    Vector<Real> work;
+
+    // thread_work[t] is a per-thread replacement of work for thread t of the shared pool
+    PerThread<Vector<Real>> thread_work;
+
+    Layout layout;
+    uint32_t nodes_count;
+    size_t row_stride;
+    size_t column_stride;
+
+    // node_column[n] is a column of the net node n (1-based), or NO_COLUMN if node is absent
+    std::vector<uint32_t> node_column;
+    // source_column[s] is a column of the source (row) s
+    std::vector<uint32_t> source_column;
+
+    std::vector<EdgeIndex> edge_index;
+    std::vector<TripIndex> trip_index;
+
+    // see setup_line()
+    const Vector<Real>* line_x;
+    const Vector<Real>* line_dir;
+
+    static constexpr uint32_t NO_COLUMN = limits<uint32_t>::max();
+
+private:
+    void
+    build_index();
 };
 
+using SDM = BasicSDM<double>;
+
 }
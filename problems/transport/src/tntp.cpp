@@ -1,22 +1,108 @@
 #include "tntp.hpp"
 
-#include <fstream>
-#include <map>
-#include <set>
+#include "core/thread_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <fmt/color.h>
 
 namespace tntp
 {
 
-using File = std::fstream;
-using NodesSet = std::set<uint32_t>;
-using EdgesMap = std::map<uint64_t, uint32_t>;
+using t_opt::ThreadPool;
+
+EdgeTable::EdgeTable()
+    : m_size(0)
+    , m_mask(0)
+    , m_shift(64)
+{
+}
 
-inline uint64_t
-edge_key(uint32_t source, uint32_t target)
+void
+EdgeTable::clear()
 {
-    return ((uint64_t)source << 32) + target;
+    m_slots.clear();
+    m_size = 0;
+    m_mask = 0;
+    m_shift = 64;
+}
+
+void
+EdgeTable::reserve(size_t count)
+{
+    // keep load factor not greater than 1/2
+    size_t capacity = 16;
+    while (capacity < 2 * count)
+    {
+        capacity *= 2;
+    }
+
+    if (capacity > m_slots.size())
+    {
+        rehash(capacity);
+    }
+}
+
+uint32_t
+EdgeTable::insert(uint32_t source, uint32_t target, uint32_t index)
+{
+    if (2 * (m_size + 1) > m_slots.size())
+    {
+        rehash(std::max<size_t>(16, 2 * m_slots.size()));
+    }
+
+    const auto key = make_key(source, target);
+    for (size_t i = slot(key); ; i = (i + 1) & m_mask)
+    {
+        auto& s = m_slots[i];
+        if (s.index == NO_EDGE)
+        {
+            s.key = key;
+            s.index = index;
+            ++m_size;
+            return NO_EDGE;
+        }
+
+        if (s.key == key)
+        {
+            return s.index;
+        }
+    }
+}
+
+void
+EdgeTable::rehash(size_t capacity)
+{
+    std::vector<Slot> slots(capacity, Slot{0, NO_EDGE});
+    slots.swap(m_slots);
+
+    m_mask = capacity - 1;
+    m_shift = 64;
+    for (size_t c = capacity; c > 1; c /= 2)
+    {
+        --m_shift;
+    }
+
+    for (const auto& s : slots)
+    {
+        if (s.index != NO_EDGE)
+        {
+            size_t i = slot(s.key);
+            while (m_slots[i].index != NO_EDGE)
+            {
+                i = (i + 1) & m_mask;
+            }
+
+            m_slots[i] = s;
+        }
+    }
 }
 
 // FIXME move into core ?
@@ -26,6 +112,11 @@ public:
     static const size_t
     npos = String::npos;
 
+    StringView()
+        : StringView(nullptr, 0)
+    {
+    }
+
     StringView(const String& str)
         : StringView(str.data(), str.size())
     {
@@ -87,36 +178,41 @@ public:
     size_t
     find_first_of(char c, size_t start) const
     {
-        for (size_t i = start; i < m_size; ++i)
+        if (start >= m_size)
         {
-            if (m_data[i] == c)
-            {
-                return i;
-            }
+            return npos;
         }
 
-        return npos;
+        auto p = static_cast<const char*>(std::memchr(m_data + start, c, m_size - start));
+        return p ? p - m_data : npos;
     }
 
-    void
-    split(char delimeter, std::vector<StringView>& result, int max_count = -1) const
+    // Moves the first item (up to delimiter) into item and drops it with the delimiter
+    // from this view, returns false when there are no more items
+    bool
+    next(char delimiter, StringView& item)
     {
-        result.clear();
-        for (size_t start = 0, end = 0; end < m_size; start = end + 1)
+        if (empty())
         {
-            end = find_first_of(delimeter, start);
-            if (end == String::npos)
-            {
-                end = m_size;
-            }
-
-            result.emplace_back(&m_data[start], end - start);
+            return false;
+        }
 
-            if ((max_count > 0) && result.size() == (size_t)max_count)
-            {
-                return;
-            }
+        auto end = find_first_of(delimiter, 0);
+        if (end == npos)
+        {
+            item = StringView(m_data, m_size);
+            m_data += m_size;
+            m_size = 0;
         }
+        else
+        {
+            item = StringView(m_data, end);
+            m_data += end + 1;
+            m_size -= end + 1;
+        }
+
+        m_trimmed = false;
+        return true;
     }
 
     inline String
@@ -131,6 +227,120 @@ private:
   bool m_trimmed;
 };
 
+// Read-only memory mapping of the whole file
+class MappedFile
+{
+public:
+    MappedFile()
+        : m_data(nullptr)
+        , m_size(0)
+    {
+    }
+
+    MappedFile(const MappedFile&) = delete;
+
+    MappedFile&
+    operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+        close();
+    }
+
+    bool
+    open(const String& file_name)
+    {
+        close();
+
+        int fd = ::open(file_name.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+
+        m_size = st.st_size;
+        if (m_size > 0)
+        {
+            void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                ::close(fd);
+                m_size = 0;
+                return false;
+            }
+
+            madvise(data, m_size, MADV_SEQUENTIAL);
+            m_data = static_cast<const char*>(data);
+        }
+
+        ::close(fd);
+        return true;
+    }
+
+    void
+    close()
+    {
+        if (m_data != nullptr)
+        {
+            munmap(const_cast<char*>(m_data), m_size);
+        }
+
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    inline StringView
+    view() const
+    {
+        return StringView(m_data, m_size);
+    }
+
+private:
+    const char* m_data;
+    size_t m_size;
+};
+
+// Splits text into lines in place, counts line numbers starting from 1
+class LineReader
+{
+public:
+    explicit
+    LineReader(StringView text, size_t line_num = 0)
+        : m_text(text)
+        , m_line_num(line_num)
+    {
+    }
+
+    inline bool
+    next(StringView& line)
+    {
+        if (m_text.next('\n', line))
+        {
+            ++m_line_num;
+            return true;
+        }
+
+        return false;
+    }
+
+    inline size_t
+    line_num() const
+    {
+        return m_line_num;
+    }
+
+private:
+    StringView m_text;
+    size_t m_line_num;
+};
+
 class ParserError : public std::exception
 {
 public:
@@ -157,6 +367,118 @@ private:
     String m_message;
 };
 
+// Locale independent parser of decimal integers, whole [begin, end) should be a number
+bool
+parse_long(const char* begin, const char* end, long& value)
+{
+    bool negative = false;
+    if (begin != end && (*begin == '-' || *begin == '+'))
+    {
+        negative = (*begin == '-');
+        ++begin;
+    }
+
+    if (begin == end || (end - begin) > 18)
+    {
+        return false;
+    }
+
+    long result = 0;
+    for (; begin != end; ++begin)
+    {
+        const unsigned digit = *begin - '0';
+        if (digit > 9)
+        {
+            return false;
+        }
+
+        result = result * 10 + digit;
+    }
+
+    value = negative ? -result : result;
+    return true;
+}
+
+// Locale independent parser of decimal floating point numbers, whole [begin, end) should be
+// a number. Numbers with up to 19 significant digits and small exponents are converted
+// exactly (both mantissa and power of 10 are exact doubles), other ones are left to strtod().
+bool
+parse_double(const char* begin, const char* end, double& value)
+{
+    static const double POW_10[] =
+    {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+
+    auto p = begin;
+
+    bool negative = false;
+    if (p != end && (*p == '-' || *p == '+'))
+    {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool has_digits = false;
+
+    for (; p != end && unsigned(*p - '0') <= 9; ++p)
+    {
+        has_digits = true;
+        if (mantissa != 0 || *p != '0')
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            ++digits;
+        }
+    }
+
+    if (p != end && *p == '.')
+    {
+        for (++p; p != end && unsigned(*p - '0') <= 9; ++p)
+        {
+            has_digits = true;
+            if (mantissa != 0 || *p != '0')
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                ++digits;
+            }
+            --exponent;
+        }
+    }
+
+    if (has_digits && p != end && (*p == 'e' || *p == 'E'))
+    {
+        long e = 0;
+        if (parse_long(p + 1, end, e) == false || std::abs(e) > 1000)
+        {
+            p = begin; // use strtod() fallback
+        }
+        else
+        {
+            exponent += e;
+            p = end;
+        }
+    }
+
+    if (has_digits && p == end && digits <= 19 && mantissa <= (uint64_t(1) << 53) && std::abs(exponent) <= 22)
+    {
+        double result = mantissa;
+        result = (exponent < 0) ? result / POW_10[-exponent] : result * POW_10[exponent];
+
+        value = negative ? -result : result;
+        return true;
+    }
+
+    // rare cases (long mantissas, inf/nan, etc)
+    String str(begin, end);
+    char* str_end = nullptr;
+    value = strtod(str.c_str(), &str_end);
+    return (str.empty() == false) && (str_end == str.c_str() + str.size());
+}
+
 long
 to_long(StringView& str, const char* value_name, const String file_name, size_t line_num)
 {
@@ -164,9 +486,8 @@ to_long(StringView& str, const char* value_name, const String file_name, size_t
     {
         str.trim();
 
-        char* end = nullptr;
-        long value = strtol(str.data(), &end, 10);
-        if (end - str.data() == (long)str.size())
+        long value;
+        if (parse_long(str.data(), str.data() + str.size(), value))
         {
             return value;
         }
@@ -183,9 +504,8 @@ to_double(StringView& str, const char* value_name, const String file_name, size_
     {
         str.trim();
 
-        char* end = nullptr;
-        double value = strtod(str.data(), &end);
-        if (end - str.data() == (long)str.size())
+        double value;
+        if (parse_double(str.data(), str.data() + str.size(), value))
         {
             return value;
         }
@@ -195,25 +515,44 @@ to_double(StringView& str, const char* value_name, const String file_name, size_
     throw ParserError(message, file_name, line_num);
 }
 
+// Builds dense node index of edges end points
+void
+index_nodes(Data& data)
+{
+    data.node_index.assign(data.max_node_index + 1, NO_NODE);
+    for (const auto& edge : data.edges)
+    {
+        data.node_index[edge.source] = 0;
+        data.node_index[edge.target] = 0;
+    }
+
+    data.nodes_count = 0;
+    for (auto& index : data.node_index)
+    {
+        if (index != NO_NODE)
+        {
+            index = data.nodes_count++;
+        }
+    }
+}
+
 void
 load_net_data(
-    File& file,
+    const MappedFile& file,
     const String& file_name,
-    NodesSet& nodes_set,
-    EdgesMap& edges_map,
     Data& data)
 {
     Edge edge;
-    size_t line_num = 0;
-    String line_str;
-    std::vector<StringView> items;
+    StringView line;
+    StringView items[7];
+
+    LineReader reader(file.view());
 
     data.max_node_index = 0;
-    while (std::getline(file, line_str))
+    data.edge_table.clear();
+    while (reader.next(line))
     {
-        ++line_num;
-
-        auto line = StringView(line_str).trim();
+        line.trim();
 
         // skip empty, comment and metadata lines
         if (line.empty() || line.starts_with('~') || line.starts_with('<'))
@@ -221,12 +560,16 @@ load_net_data(
             continue;
         }
 
-        line.split('\t', items);
-        if (items.size() < 7)
+        for (auto& item : items)
         {
-            throw ParserError("line contains less than 7 columns", file_name, line_num);
+            if (line.next('\t', item) == false)
+            {
+                throw ParserError("line contains less than 7 columns", file_name, reader.line_num());
+            }
         }
 
+        const auto line_num = reader.line_num();
+
         edge.source = to_long(items[0], "edge source", file_name, line_num);
         edge.target = to_long(items[1], "edge target", file_name, line_num);
         edge.capacity = to_double(items[2], "edge capacity", file_name, line_num);
@@ -234,28 +577,25 @@ load_net_data(
         edge.b = to_double(items[5], "edge B parameter", file_name, line_num);
         edge.p = to_double(items[6], "edge P parameter", file_name, line_num);
 
-        auto key = edge_key(edge.source, edge.target);
-        auto it = edges_map.find(key);
-        if (it == edges_map.end())
+        auto existing = data.edge_table.insert(edge.source, edge.target, data.edges.size());
+        if (existing == NO_EDGE)
         {
-            edges_map.insert(std::make_pair(key, (uint32_t)data.edges.size()));
             data.edges.push_back(edge);
         }
         else
         {
             printf("warning: edge '%u -> %u' already exists, replace with new one\n", edge.source, edge.target);
-            data.edges[it->second] = edge;
+            data.edges[existing] = edge;
         }
 
-        nodes_set.insert(edge.source);
-        nodes_set.insert(edge.target);
-
         data.max_node_index = std::max(data.max_node_index, edge.source);
         data.max_node_index = std::max(data.max_node_index, edge.target);
     }
 
-    printf("  nodes: %zu", nodes_set.size());
-    if (nodes_set.size() != data.max_node_index)
+    index_nodes(data);
+
+    printf("  nodes: %u", data.nodes_count);
+    if (data.nodes_count != data.max_node_index)
     {
         printf(" (max node index: %u)", data.max_node_index);
     }
@@ -265,33 +605,102 @@ load_net_data(
 
 }
 
+// Trips of consecutive lines of trips file starting with 'Origin' one (except the first chunk)
+struct TripsChunk
+{
+    StringView text;
+    size_t line_num;
+
+    std::vector<Trip> trips;
+    std::vector<uint32_t> sources;
+    std::exception_ptr error;
+};
+
+// Trips files smaller than this are parsed in one chunk
+constexpr size_t TRIPS_CHUNK_SIZE = 1 << 20;
+
+// Splits trips file text into about count chunks at 'Origin' lines
+std::vector<TripsChunk>
+split_trips(StringView text, size_t count)
+{
+    std::vector<TripsChunk> chunks;
+
+    auto is_origin = [&text](size_t start)
+    {
+        for (size_t i = start; i < text.size() && text.data()[i] != '\n'; ++i)
+        {
+            const char c = text.data()[i];
+            if (std::isspace(c) == false)
+            {
+                return c == 'O' || c == 'o';
+            }
+        }
+
+        return false;
+    };
+
+    size_t start = 0;
+    size_t line_num = 0;
+    for (size_t i = 1; i <= count; ++i)
+    {
+        size_t end = text.size();
+        if (i < count)
+        {
+            // first origin line starting at or after the approximate chunk end
+            end = std::max(text.size() * i / count, start + 1);
+            if (end < text.size() && text.data()[end - 1] != '\n')
+            {
+                end = text.find_first_of('\n', end);
+                end = (end == StringView::npos) ? text.size() : end + 1;
+            }
+
+            while (end < text.size() && is_origin(end) == false)
+            {
+                end = text.find_first_of('\n', end);
+                end = (end == StringView::npos) ? text.size() : end + 1;
+            }
+        }
+
+        if (end > start)
+        {
+            chunks.emplace_back();
+            chunks.back().text = StringView(text.data() + start, end - start);
+            chunks.back().line_num = line_num;
+
+            line_num += std::count(text.data() + start, text.data() + end, '\n');
+            start = end;
+        }
+    }
+
+    return chunks;
+}
+
 void
-load_trips_data(
-    File& file,
+load_trips_chunk(
     const String& file_name,
-    const NodesSet& nodes_set,
-    Data& data)
+    const Data& data,
+    bool first,
+    TripsChunk& chunk)
 {
     Trip trip;
-    size_t line_num = 0;
     size_t o_source = 0;
     bool has_source = false;
-    String line_str;
-    NodesSet sources_set;
-    std::vector<StringView> items;
-    std::vector<StringView> items_2;
+    StringView line;
+    StringView item;
+    StringView target;
+
+    LineReader reader(chunk.text, chunk.line_num);
 
-    auto throw_error = [&file_name, &line_num](const String& message)
+    auto throw_error = [&file_name, &reader](const String& message)
     {
-        throw ParserError(message, file_name, line_num);
+        throw ParserError(message, file_name, reader.line_num());
     };
 
-    data.total_flow = 0.0;
-    while (std::getline(file, line_str))
+    while (reader.next(line))
     {
-        ++line_num;
+        const auto line_num = reader.line_num();
 
-        auto line = StringView(line_str).trim();
+        line.trim();
 
         // skip empty, comment and metadata lines
         if (line.empty() || line.starts_with('~') || line.starts_with('<'))
@@ -301,51 +710,57 @@ load_trips_data(
 
         if (line.starts_with('O') || line.starts_with('o'))
         {
-            line.split(' ', items, 2);
-            if (items.size() != 2)
+            // 'Origin' keyword and the rest of line
+            auto source = line;
+            if (source.next(' ', item) == false || source.empty())
             {
                 throw_error(fmt::format("wrong data - '{}', cant parse it as trip source (origin)", line.to_string()));
             }
 
-            o_source = to_long(items[1], "trip source (origin)", file_name, line_num);
-            if (nodes_set.find(o_source) == nodes_set.end())
+            o_source = to_long(source, "trip source (origin)", file_name, line_num);
+            if (!data.has_node(o_source))
             {
                 throw_error(fmt::format("trip source '{}' does not present in the net", o_source));
             }
 
-            sources_set.insert(o_source);
+            chunk.sources.push_back(o_source);
             has_source = true;
             continue;
         }
 
-        if (!has_source)
+        // only the first chunk may start without origin line
+        if (!has_source && first)
         {
             throw_error("no opening trip source");
         }
 
-        line.split(';', items);
-        for (size_t i = 0; i < items.size(); ++i)
+        while (line.next(';', item))
         {
-            if (items[i].trim().empty())
+            if (item.trim().empty())
             {
                 continue;
             }
 
-            items[i].split(':', items_2);
-            if (items_2.size() < 2)
+            // 'trip_target : trip_flow', the rest of item is flow
+            auto flow = item;
+            if (flow.next(':', target) == false || flow.empty())
             {
                 throw_error(fmt::format("wrong data - '{}', can't parse it as 'trip_target : trip_flow'",
-                                        items[i].to_string()));
+                                        item.to_string()));
             }
 
+            // only first two ':' separated values are used
+            auto flow_end = flow;
+            flow_end.next(':', flow);
+
             trip.source = o_source;
-            trip.target = to_long(items_2[0], "trip target", file_name, line_num);
-            if (nodes_set.find(trip.target) == nodes_set.end())
+            trip.target = to_long(target, "trip target", file_name, line_num);
+            if (!data.has_node(trip.target))
             {
                 throw_error(fmt::format("trip target '{}' does not present in the net", trip.target));
             }
 
-            trip.flow = to_double(items_2[1], "trip flow", file_name, line_num);
+            trip.flow = to_double(flow, "trip flow", file_name, line_num);
 
             trip.flow *= 0.001; // FIXME remove - test with Yura
 //             trip.flow *= 0.1; // FIXME remove - test with Yura
@@ -355,12 +770,77 @@ load_trips_data(
             // 2) drop if flow <= 0
             // 3) drop if source == target
 
+            chunk.trips.push_back(trip);
+        }
+    }
+}
+
+void
+load_trips_data(
+    const MappedFile& file,
+    const String& file_name,
+    Data& data)
+{
+    const auto text = file.view();
+    auto& pool = ThreadPool::shared();
+    const size_t threads = pool.size();
+    const size_t count = std::min(4 * threads, text.size() / TRIPS_CHUNK_SIZE + 1);
+
+    auto chunks = split_trips(text, count);
+
+    auto task = [&](size_t i, size_t)
+    {
+        try
+        {
+            load_trips_chunk(file_name, data, i == 0, chunks[i]);
+        }
+        catch (...)
+        {
+            chunks[i].error = std::current_exception();
+        }
+    };
+
+    // serial when loading from a task of the pool (parallel bench jobs)
+    pool.run(chunks.size(), task);
+
+    // merge in file order, so the first error and the total flow are the same as for sequential parsing
+    size_t trips_count = 0;
+    for (const auto& chunk : chunks)
+    {
+        if (chunk.error)
+        {
+            std::rethrow_exception(chunk.error);
+        }
+
+        trips_count += chunk.trips.size();
+    }
+
+    std::vector<uint8_t> sources_mask(data.node_index.size(), 0);
+
+    data.trips.reserve(data.trips.size() + trips_count);
+    data.total_flow = 0.0;
+    for (const auto& chunk : chunks)
+    {
+        for (const auto& trip : chunk.trips)
+        {
             data.trips.push_back(trip);
             data.total_flow += trip.flow;
         }
+
+        for (auto source : chunk.sources)
+        {
+            sources_mask[source] = 1;
+        }
     }
 
-    data.sources = std::vector<uint32_t>(sources_set.begin(), sources_set.end());
+    data.sources.clear();
+    for (size_t node = 0; node < sources_mask.size(); ++node)
+    {
+        if (sources_mask[node])
+        {
+            data.sources.push_back(node);
+        }
+    }
 
     printf("  zones: %zu\n", data.sources.size());
     printf("  trips: %zu\n", data.trips.size());
@@ -368,31 +848,30 @@ load_trips_data(
 
 void
 load_flow_data(
-    File& file,
+    const MappedFile& file,
     bool is_csv,
     const String& file_name,
-    const NodesSet& nodes_set,
-    const EdgesMap& edges_map,
     Data& data)
 {
     bool has_header = false;
-    size_t line_num = 0;
-    String line_str;
-    std::vector<StringView> items;
+    StringView line;
+    StringView items[4];
 
-    auto throw_error = [&file_name, &line_num](const String& message)
+    LineReader reader(file.view());
+
+    auto throw_error = [&file_name, &reader](const String& message)
     {
-        throw ParserError(message, file_name, line_num);
+        throw ParserError(message, file_name, reader.line_num());
     };
 
     data.flow.resize(data.edges.size());
     data.flow.setZero();
 
-    while (std::getline(file, line_str))
+    while (reader.next(line))
     {
-        ++line_num;
+        const auto line_num = reader.line_num();
 
-        auto line = StringView(line_str).trim();
+        line.trim();
 
         // skip empty and comment lines
         if (line.empty() || line.starts_with('~'))
@@ -411,50 +890,42 @@ load_flow_data(
             throw_error("it looks like there is no header in flow file");
         }
 
-        if (is_csv)
-        {
-            line.split(';', items);
-            if (items.size() < 4) // FIXME change order in saver software (flow optimize)
-            {
-                throw_error("line contains less than 3 columns");
-            }
-        }
-        else
+        // FIXME change order in saver software (flow optimize)
+        const auto delimiter = is_csv ? ';' : '\t';
+        const size_t columns = is_csv ? 4 : 3;
+        for (size_t i = 0; i < columns; ++i)
         {
-            line.split('\t', items);
-            if (items.size() < 3)
+            if (line.next(delimiter, items[i]) == false)
             {
                 throw_error("line contains less than 3 columns");
             }
         }
 
-
         const uint32_t source = to_long(items[0], "flow source", file_name, line_num);
-        if (nodes_set.find(source) == nodes_set.end())
+        if (!data.has_node(source))
         {
             throw_error(fmt::format("flow source '{}' does not present in the net", source));
         }
 
         const uint32_t target = to_long(items[1], "flow target", file_name, line_num);
-        if (nodes_set.find(target) == nodes_set.end())
+        if (!data.has_node(target))
         {
             throw_error(fmt::format("flow target '{}' does not present in the net", source));
         }
 
-        const auto key = edge_key(source, target);
-        const auto it = edges_map.find(key);
-        if (it == edges_map.end())
+        const auto e = data.find_edge(source, target);
+        if (e == NO_EDGE)
         {
             throw_error(fmt::format("edge '{} -> {}' does not present in the net", source, target));
         }
 
         if (is_csv)
         {
-            data.flow[it->second] = to_double(items[3], "flow value", file_name, line_num);
+            data.flow[e] = to_double(items[3], "flow value", file_name, line_num);
         }
         else
         {
-            data.flow[it->second] = to_double(items[2], "flow value", file_name, line_num);
+            data.flow[e] = to_double(items[2], "flow value", file_name, line_num);
         }
     }
 
@@ -468,47 +939,474 @@ load_flow_data(
     }
 }
 
+// Binary snapshot of loaded data, see load_tntp_data()
+namespace cache
+{
+
+constexpr char MAGIC[8] = {'T', 'N', 'T', 'P', 'B', 'I', 'N', '\0'};
+constexpr uint32_t VERSION = 2;
+
+// net, trips, flow (CSV) and flow files
+constexpr size_t SOURCES_COUNT = 4;
+
+struct FileStamp
+{
+    uint64_t size;
+    int64_t  mtime;
+    uint64_t hash;
+    uint32_t exists;
+    uint32_t reserved;
+};
+
+struct Header
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t max_node_index;
+
+    FileStamp stamps[SOURCES_COUNT];
+
+    uint64_t edges_count;
+    uint64_t trips_count;
+    uint64_t runs_count;
+    uint64_t sources_count;
+    uint64_t flow_count;
+
+    double   total_flow;
+    uint64_t file_size;
+};
+
+FileStamp
+stamp_file(const String& file_name)
+{
+    FileStamp stamp = {};
+
+    struct stat st;
+    if (stat(file_name.c_str(), &st) == 0)
+    {
+        stamp.exists = 1;
+        stamp.size = st.st_size;
+        stamp.mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    }
+
+    return stamp;
+}
+
+// Fast non-cryptographic hash of the whole file, processes 8 bytes per step
+uint64_t
+hash_file(const String& file_name)
+{
+    MappedFile file;
+    if (file.open(file_name) == false)
+    {
+        return 0;
+    }
+
+    const auto view = file.view();
+    const size_t size = view.size();
+
+    uint64_t hash = 0xcbf29ce484222325 ^ size;
+    auto mix = [&hash](uint64_t word)
+    {
+        hash = (hash ^ word) * 0x9e3779b97f4a7c15;
+        hash ^= hash >> 32;
+    };
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, view.data() + i, 8);
+        mix(word);
+    }
+
+    if (i < size)
+    {
+        uint64_t word = 0;
+        std::memcpy(&word, view.data() + i, size - i);
+        mix(word);
+    }
+
+    return hash;
+}
+
+inline size_t
+aligned(size_t size)
+{
+    return (size + 7) & ~size_t(7);
+}
+
+class Writer
+{
+public:
+    template <typename T>
+    void
+    put(const T* values, size_t count)
+    {
+        const auto offset = m_buffer.size();
+        m_buffer.resize(offset + aligned(count * sizeof(T)), 0);
+        if (count > 0)
+        {
+            std::memcpy(&m_buffer[offset], values, count * sizeof(T));
+        }
+    }
+
+    std::vector<char>&
+    buffer()
+    {
+        return m_buffer;
+    }
+
+private:
+    std::vector<char> m_buffer;
+};
+
+// Gives access to arrays of mapped cache file in place
+class Reader
+{
+public:
+    explicit
+    Reader(StringView view)
+        : m_view(view)
+        , m_offset(0)
+    {
+    }
+
+    // Returns nullptr if file is too short
+    template <typename T>
+    const T*
+    get(size_t count)
+    {
+        const auto size = aligned(count * sizeof(T));
+        if (m_offset + size > m_view.size())
+        {
+            return nullptr;
+        }
+
+        auto values = reinterpret_cast<const T*>(m_view.data() + m_offset);
+        m_offset += size;
+        return values;
+    }
+
+private:
+    StringView m_view;
+    size_t m_offset;
+};
+
+// Sources with the cached size and modification time are trusted without reading them, others
+// are hashed. restamp is set when all hashes match, but some modification times are changed.
+bool
+load(const String& file_name, const String* (&source_names)[SOURCES_COUNT], FileStamp (&stamps)[SOURCES_COUNT],
+     Data& data, bool& restamp)
+{
+    MappedFile file;
+    if (file.open(file_name) == false)
+    {
+        return false;
+    }
+
+    Reader reader(file.view());
+
+    auto mapped_header = reader.get<Header>(1);
+    if (mapped_header == nullptr)
+    {
+        return false;
+    }
+
+    const auto header = *mapped_header;
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.file_size != file.view().size())
+    {
+        return false;
+    }
+
+    restamp = false;
+    for (size_t i = 0; i < SOURCES_COUNT; ++i)
+    {
+        const auto& cached = header.stamps[i];
+        if (cached.exists != stamps[i].exists || cached.size != stamps[i].size)
+        {
+            return false;
+        }
+
+        if (cached.mtime != stamps[i].mtime)
+        {
+            if (cached.hash != hash_file(*source_names[i]))
+            {
+                return false;
+            }
+
+            restamp = true;
+        }
+
+        stamps[i].hash = cached.hash;
+    }
+
+    const size_t edges_count = header.edges_count;
+    const auto edge_source = reader.get<uint32_t>(edges_count);
+    const auto edge_target = reader.get<uint32_t>(edges_count);
+    const auto edge_capacity = reader.get<double>(edges_count);
+    const auto edge_free_flow_time = reader.get<double>(edges_count);
+    const auto edge_b = reader.get<double>(edges_count);
+    const auto edge_p = reader.get<double>(edges_count);
+
+    const size_t trips_count = header.trips_count;
+    const auto run_source = reader.get<uint32_t>(header.runs_count);
+    const auto run_count = reader.get<uint32_t>(header.runs_count);
+    const auto trip_target = reader.get<uint32_t>(trips_count);
+    const auto trip_flow = reader.get<double>(trips_count);
+
+    const auto sources = reader.get<uint32_t>(header.sources_count);
+    const auto flow = reader.get<double>(header.flow_count);
+
+    // the last array is present only if all previous ones are
+    if (flow == nullptr)
+    {
+        return false;
+    }
+
+    size_t runs_total = 0;
+    for (size_t r = 0; r < header.runs_count; ++r)
+    {
+        runs_total += run_count[r];
+    }
+
+    if (runs_total != trips_count)
+    {
+        return false;
+    }
+
+    data.edges.resize(edges_count);
+    for (size_t i = 0; i < edges_count; ++i)
+    {
+        auto& edge = data.edges[i];
+        edge.source = edge_source[i];
+        edge.target = edge_target[i];
+        edge.capacity = edge_capacity[i];
+        edge.free_flow_time = edge_free_flow_time[i];
+        edge.b = edge_b[i];
+        edge.p = edge_p[i];
+        edge.travel_time = 0.0;
+    }
+
+    // lookup structures are not stored
+    data.max_node_index = header.max_node_index;
+    index_nodes(data);
+
+    data.edge_table.clear();
+    data.edge_table.reserve(edges_count);
+    for (size_t i = 0; i < edges_count; ++i)
+    {
+        data.edge_table.insert(edge_source[i], edge_target[i], i);
+    }
+
+    data.trips.resize(trips_count);
+    for (size_t r = 0, i = 0; r < header.runs_count; ++r)
+    {
+        for (size_t k = 0; k < run_count[r]; ++k, ++i)
+        {
+            data.trips[i].source = run_source[r];
+            data.trips[i].target = trip_target[i];
+            data.trips[i].flow = trip_flow[i];
+        }
+    }
+
+    data.sources.assign(sources, sources + header.sources_count);
+    if (header.flow_count > 0)
+    {
+        data.flow = Eigen::Map<const t_opt::DVector>(flow, header.flow_count);
+    }
+
+    data.total_flow = header.total_flow;
+
+    printf("  nodes: %u", data.nodes_count);
+    if (data.nodes_count != data.max_node_index)
+    {
+        printf(" (max node index: %u)", data.max_node_index);
+    }
+    printf("\n");
+
+    printf("  links: %zu\n", data.edges.size());
+    printf("  zones: %zu\n", data.sources.size());
+    printf("  trips: %zu\n", data.trips.size());
+
+    if (header.flow_count > 0)
+    {
+        printf("   flow: %ld%s\n", data.flow.size(), header.stamps[2].exists ? " (CSV)" : "");
+    }
+
+    printf("  cache: %s\n", file_name.c_str());
+    return true;
+}
+
+// Failures are not fatal - data is simply parsed again next time
+void
+save(const String& file_name, const FileStamp (&stamps)[SOURCES_COUNT], const Data& data)
+{
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.max_node_index = data.max_node_index;
+    std::copy(std::begin(stamps), std::end(stamps), header.stamps);
+
+    header.edges_count = data.edges.size();
+    header.trips_count = data.trips.size();
+    header.sources_count = data.sources.size();
+    header.flow_count = data.flow.size();
+    header.total_flow = data.total_flow;
+
+    // edges as separate columns
+    std::vector<uint32_t> u32_column(data.edges.size());
+    std::vector<double> f64_column(data.edges.size());
+
+    Writer writer;
+    writer.put(&header, 1);
+
+    auto put_edges_u32 = [&](uint32_t Edge::* field)
+    {
+        for (size_t i = 0; i < data.edges.size(); ++i)
+        {
+            u32_column[i] = data.edges[i].*field;
+        }
+        writer.put(u32_column.data(), u32_column.size());
+    };
+
+    auto put_edges_f64 = [&](double Edge::* field)
+    {
+        for (size_t i = 0; i < data.edges.size(); ++i)
+        {
+            f64_column[i] = data.edges[i].*field;
+        }
+        writer.put(f64_column.data(), f64_column.size());
+    };
+
+    put_edges_u32(&Edge::source);
+    put_edges_u32(&Edge::target);
+    put_edges_f64(&Edge::capacity);
+    put_edges_f64(&Edge::free_flow_time);
+    put_edges_f64(&Edge::b);
+    put_edges_f64(&Edge::p);
+
+    // trips as runs of the same source in the original order
+    std::vector<uint32_t> run_source;
+    std::vector<uint32_t> run_count;
+    std::vector<uint32_t> trip_target(data.trips.size());
+    std::vector<double> trip_flow(data.trips.size());
+
+    for (size_t i = 0; i < data.trips.size(); ++i)
+    {
+        const auto& trip = data.trips[i];
+        if (run_source.empty() || run_source.back() != trip.source)
+        {
+            run_source.push_back(trip.source);
+            run_count.push_back(0);
+        }
+
+        ++run_count.back();
+        trip_target[i] = trip.target;
+        trip_flow[i] = trip.flow;
+    }
+
+    writer.put(run_source.data(), run_source.size());
+    writer.put(run_count.data(), run_count.size());
+    writer.put(trip_target.data(), trip_target.size());
+    writer.put(trip_flow.data(), trip_flow.size());
+
+    writer.put(data.sources.data(), data.sources.size());
+    writer.put(data.flow.data(), data.flow.size());
+
+    auto& buffer = writer.buffer();
+    header.runs_count = run_source.size();
+    header.file_size = buffer.size();
+    std::memcpy(buffer.data(), &header, sizeof(header));
+
+    // write into temporary file and rename it, so readers never see partial cache, temporary
+    // name is unique for every writer (bench loads networks in several threads)
+    static std::atomic<uint32_t> writer_id(0);
+    const auto temp_name = fmt::format("{}.{}.{}", file_name, getpid(), writer_id++);
+
+    FILE* file = fopen(temp_name.c_str(), "wb");
+    if (file == nullptr)
+    {
+        return;
+    }
+
+    const bool written = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    if (fclose(file) != 0 || !written || rename(temp_name.c_str(), file_name.c_str()) != 0)
+    {
+        printf("warning: unable to write cache '%s'\n", file_name.c_str());
+        remove(temp_name.c_str());
+    }
+}
+
+}
+
 void
-load_tntp_data(const String& path, const String& name, Data& data)
+load_tntp_data(const String& path, const String& name, Data& data, bool use_cache)
 {
     String prefix = fmt::format("{0}/{1}/{1}", path, name);
     String net_name = prefix + "_net.tntp";
     String trips_name = prefix + "_trips.tntp";
     String flow_name = prefix + "_flow.tntp";
     String flow_csv_name = prefix + "_flow.csv";
+    String cache_name = prefix + "_cache.bin";
 
     printf("Loading TNTP data from %s/%s\n", path.c_str(), name.c_str());
 
-    File net_file(net_name, std::ios::in);
-    if (net_file.is_open() == false)
+    const String* names[] = {&net_name, &trips_name, &flow_csv_name, &flow_name};
+    cache::FileStamp stamps[cache::SOURCES_COUNT];
+    if (use_cache)
+    {
+        for (size_t i = 0; i < cache::SOURCES_COUNT; ++i)
+        {
+            stamps[i] = cache::stamp_file(*names[i]);
+        }
+
+        bool restamp = false;
+        if (cache::load(cache_name, names, stamps, data, restamp))
+        {
+            // store new modification times, so files are not hashed on every load
+            if (restamp)
+            {
+                cache::save(cache_name, stamps, data);
+            }
+            return;
+        }
+    }
+
+    MappedFile net_file;
+    if (net_file.open(net_name) == false)
     {
         throw ParserError(fmt::format("unable to open file '{}'", net_name));
     }
 
-    File trips_file(trips_name, std::ios::in);
-    if (net_file.is_open() == false)
+    MappedFile trips_file;
+    if (trips_file.open(trips_name) == false)
     {
         throw ParserError(fmt::format("unable to open file '{}'", trips_name));
     }
 
-    NodesSet nodes_set;
-    EdgesMap edges_map;
-
-    load_net_data(net_file, net_name, nodes_set, edges_map, data);
-    load_trips_data(trips_file, trips_name, nodes_set, data);
+    load_net_data(net_file, net_name, data);
+    load_trips_data(trips_file, trips_name, data);
 
-    File flow_file(flow_csv_name, std::ios::in);
-    if (flow_file.is_open())
+    MappedFile flow_file;
+    if (flow_file.open(flow_csv_name))
     {
-        load_flow_data(flow_file, true, flow_name, nodes_set, edges_map, data);
+        load_flow_data(flow_file, true, flow_name, data);
     }
-    else
+    else if (flow_file.open(flow_name))
     {
-        File flow_file(flow_name, std::ios::in);
-        if (flow_file.is_open())
+        load_flow_data(flow_file, false, flow_name, data);
+    }
+
+    if (use_cache)
+    {
+        for (size_t i = 0; i < cache::SOURCES_COUNT; ++i)
         {
-            load_flow_data(flow_file, false, flow_name, nodes_set, edges_map, data);
+            stamps[i].hash = stamps[i].exists ? cache::hash_file(*names[i]) : 0;
         }
+
+        cache::save(cache_name, stamps, data);
     }
 }
 
@@ -7,6 +7,10 @@ namespace tntp
 
 using t_opt::String;
 
+// Marks absent nodes in Data::node_index and absent edges in EdgeTable
+constexpr uint32_t NO_NODE = t_opt::limits<uint32_t>::max();
+constexpr uint32_t NO_EDGE = t_opt::limits<uint32_t>::max();
+
 struct Edge
 {
     uint32_t source;
@@ -38,6 +42,77 @@ struct Trip
     double   flow;
 };
 
+// Open addressing (linear probing) hash table of edge indices keyed by (source, target)
+class EdgeTable
+{
+public:
+    EdgeTable();
+
+    void
+    clear();
+
+    void
+    reserve(size_t count);
+
+    inline size_t
+    size() const
+    {
+        return m_size;
+    }
+
+    // Returns index of edge (source, target) or NO_EDGE
+    inline uint32_t
+    find(uint32_t source, uint32_t target) const
+    {
+        if (m_size == 0)
+        {
+            return NO_EDGE;
+        }
+
+        const auto key = make_key(source, target);
+        for (size_t i = slot(key); ; i = (i + 1) & m_mask)
+        {
+            const auto& s = m_slots[i];
+            if (s.index == NO_EDGE || s.key == key)
+            {
+                return s.index;
+            }
+        }
+    }
+
+    // Adds edge (source, target) with given index if it is absent, returns index of
+    // the existing edge or NO_EDGE if the edge was added
+    uint32_t
+    insert(uint32_t source, uint32_t target, uint32_t index);
+
+private:
+    struct Slot
+    {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    static inline uint64_t
+    make_key(uint32_t source, uint32_t target)
+    {
+        return ((uint64_t)source << 32) + target;
+    }
+
+    inline size_t
+    slot(uint64_t key) const
+    {
+        return (key * 0x9e3779b97f4a7c15) >> m_shift;
+    }
+
+    void
+    rehash(size_t capacity);
+
+    std::vector<Slot> m_slots;
+    size_t m_size;
+    size_t m_mask;
+    uint32_t m_shift;
+};
+
 struct Data
 {
     std::vector<Edge> edges;
@@ -48,10 +123,33 @@ struct Data
     double total_flow;
 
     uint32_t max_node_index;
+
+    // node_index[n] is a dense index of the net node n (nodes are numbered in increasing
+    // order), or NO_NODE if n is absent, size is max_node_index + 1
+    std::vector<uint32_t> node_index;
+    uint32_t nodes_count;
+
+    // (source, target) -> index in edges
+    EdgeTable edge_table;
+
+    inline bool
+    has_node(size_t node) const
+    {
+        return node < node_index.size() && node_index[node] != NO_NODE;
+    }
+
+    inline uint32_t
+    find_edge(uint32_t source, uint32_t target) const
+    {
+        return edge_table.find(source, target);
+    }
 };
 
+// Parsed data is saved into binary '<name>_cache.bin' file next to the source ones and is reused
+// on later loads while net, trips and flow files keep the same size and modification time. Files
+// with a new modification time (touched or copied) are hashed and compared with hashes in the cache.
 void
-load_tntp_data(const String& path, const String& name, Data& data);
+load_tntp_data(const String& path, const String& name, Data& data, bool use_cache = true);
 
 }
 
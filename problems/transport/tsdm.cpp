@@ -1,5 +1,7 @@
 #include "tsdm.hpp"
 
+#include "src/kernels.hpp"
+
 #include "core/blas.hpp"
 
 namespace transport
@@ -7,25 +9,33 @@ namespace transport
 
 #define BETTER_GRADIENT
 
-TSDM::TSDM(const String& path, const String& name)
-    : SDM("TSDM", path, name)
+template <typename Real>
+BasicTSDM<Real>::BasicTSDM(const String& path, const String& name, Layout layout)
+    : BasicSDM<Real>("TSDM", path, name, layout)
 {
+    // see BasicSmVSDM2()
+    if (layout == Layout::NodeMajor)
+    {
+        this->m_properties |= ProblemProperty::LineEvaluation;
+    }
 }
 
+template <typename Real>
 void
-TSDM::restore_flow(Point& point)
+BasicTSDM<Real>::restore_flow(Point& point)
 {
     const auto& x = point.x;
 
-    for (const auto& edge : data.edges)
+    for (size_t e = 0; e < data.edges.size(); ++e)
     {
+        const auto& edge = data.edges[e];
         const auto i = edge.source;
         const auto j = edge.target;
 
         const auto f = edge.capacity;
 //         const auto t = edge.free_flow_time;
 
-        auto pair = calc_exp_sum(x, edge, 1e-8);
+        auto pair = calc_exp_sum(x, e, 1e-8);
         auto u_max = pair.first;
         auto exp_sum = pair.second;
 
@@ -49,38 +59,90 @@ TSDM::restore_flow(Point& point)
     }
 }
 
+template <typename Real>
 void
-TSDM::f(Point& p)
+BasicTSDM<Real>::f(Point& p)
 {
     const auto& x = p.x;
 
     double phi1 = 0.0;
-    for (const auto& trip : data.trips)
+    for (size_t k = 0; k < data.trips.size(); ++k)
     {
-        const auto s = trip.source;
-        const auto k = trip.target;
-        const auto d = trip.flow;
+        const auto& trip = trip_index[k];
+        const auto d = data.trips[k].flow;
 
-        phi1 -= d * (T(x, s, k) - T(x, s, s));
+        phi1 -= d * (T(x, trip.row, trip.target) - T(x, trip.row, trip.source));
     }
 
     double phi2 = 0.0;
-    for (const auto& edge : data.edges)
+    for (size_t e = 0; e < data.edges.size(); ++e)
     {
-        const auto i = edge.source;
-        const auto j = edge.target;
+        const auto i = edge_index[e].source;
+        const auto j = edge_index[e].target;
 
-        const auto f = edge.capacity;
-        const auto t = edge.free_flow_time;
+        const auto f = data.edges[e].capacity;
+        const auto t = data.edges[e].free_flow_time;
 
-        double max = 0.0;
-        for (auto s : data.sources)
+        const auto max = kernels::diff_max(&T(x, 0, j), &T(x, 0, i), row_stride, data.sources.size(), t, work.data());
+
+        phi2 += f * max;
+    }
+
+    p.f = phi1 + phi2;
+}
+
+template <typename Real>
+void
+BasicTSDM<Real>::fdf(Point& p)
+{
+    const auto& x = p.x;
+    auto& g = p.g;
+
+    blas::set_zero(g);
+
+    double phi1 = 0.0;
+    for (size_t k = 0; k < data.trips.size(); ++k)
+    {
+        const auto& trip = trip_index[k];
+        const auto d = data.trips[k].flow;
+
+        phi1 -= d * (T(x, trip.row, trip.target) - T(x, trip.row, trip.source));
+
+        T(g, trip.row, trip.target) -= d;
+        T(g, trip.row, trip.source) += d;
+    }
+
+    double phi2 = 0.0;
+    for (size_t e = 0; e < data.edges.size(); ++e)
+    {
+        const auto i = edge_index[e].source;
+        const auto j = edge_index[e].target;
+
+        const auto f = data.edges[e].capacity;
+        const auto t = data.edges[e].free_flow_time;
+        const auto n = data.sources.size();
+
+        const auto max = kernels::diff_max(&T(x, 0, j), &T(x, 0, i), row_stride, n, t, work.data());
+        if (max <= 0.0)
         {
-            const auto value = T(x, s, j) - T(x, s, i) - t;
-            max = std::max(max, value);
+            continue;
         }
 
         phi2 += f * max;
+
+#ifdef BETTER_GRADIENT
+        kernels::scatter_max(&T(g, 0, j), &T(g, 0, i), row_stride, n, work.data(), max, f);
+#else
+        for (uint32_t s = 0; s < n; ++s)
+        {
+            if (work[s] == max)
+            {
+                T(g, s, j) += f;
+                T(g, s, i) -= f;
+                break;
+            }
+        }
+#endif
     }
 
     p.f = phi1 + phi2;
@@ -91,89 +153,75 @@ TSDM::f(Point& p)
 // this version is better by result function value (tested on SiouxFalls)
 // but slightly slower than upper ("plain") - about 12% slowdown
 
+template <typename Real>
 void
-TSDM::df(Point& p)
+BasicTSDM<Real>::df(Point& p)
 {
     const auto& x = p.x;
     auto& g = p.g;
 
-    for (const auto& trip : data.trips)
+    blas::set_zero(g);
+
+    for (size_t k = 0; k < data.trips.size(); ++k)
     {
-        const auto s = trip.source;
-        const auto k = trip.target;
-        const auto d = trip.flow;
+        const auto& trip = trip_index[k];
+        const auto d = data.trips[k].flow;
 
-        T(g, s, k) -= d;
-        T(g, s, s) += d;
+        T(g, trip.row, trip.target) -= d;
+        T(g, trip.row, trip.source) += d;
     }
 
-    for (const auto& edge : data.edges)
+    for (size_t e = 0; e < data.edges.size(); ++e)
     {
-        const auto i = edge.source;
-        const auto j = edge.target;
+        const auto i = edge_index[e].source;
+        const auto j = edge_index[e].target;
 
-        const auto f = edge.capacity;
-        const auto t = edge.free_flow_time;
+        const auto f = data.edges[e].capacity;
+        const auto t = data.edges[e].free_flow_time;
 
-        double max = 0.0;
-        bool has_max = false;
-        for (uint32_t k = 0; k < data.sources.size(); ++k)
-        {
-            const auto s = data.sources[k];
-            work[k] = T(x, s, j) - T(x, s, i) - t;
-            if (work[k] > max)
-            {
-                max = work[k];
-                has_max = true;
-            }
-        }
+        const auto n = data.sources.size();
 
-        if (has_max == false)
+        const auto max = kernels::diff_max(&T(x, 0, j), &T(x, 0, i), row_stride, n, t, work.data());
+        if (max <= 0.0)
         {
             continue;
         }
 
-        for (uint32_t k = 0; k < data.sources.size(); ++k)
-        {
-            if (work[k] == max)
-            {
-                const auto s = data.sources[k];
-                T(g, s, j) += f;
-                T(g, s, i) -= f;
-            }
-        }
+        kernels::scatter_max(&T(g, 0, j), &T(g, 0, i), row_stride, n, work.data(), max, f);
     }
 }
 
 #else
 
+template <typename Real>
 void
-TSDM::df(Point& p)
+BasicTSDM<Real>::df(Point& p)
 {
     const auto& x = p.x;
     auto& g = p.g;
 
-    for (const auto& trip : data.trips)
+    blas::set_zero(g);
+
+    for (size_t k = 0; k < data.trips.size(); ++k)
     {
-        const auto s = trip.source;
-        const auto k = trip.target;
-        const auto d = trip.flow;
+        const auto& trip = trip_index[k];
+        const auto d = data.trips[k].flow;
 
-        T(g, s, k) -= d;
-        T(g, s, s) += d;
+        T(g, trip.row, trip.target) -= d;
+        T(g, trip.row, trip.source) += d;
     }
 
-    for (const auto& edge : data.edges)
+    for (size_t e = 0; e < data.edges.size(); ++e)
     {
-        const auto i = edge.source;
-        const auto j = edge.target;
+        const auto i = edge_index[e].source;
+        const auto j = edge_index[e].target;
 
-        const auto f = edge.capacity;
-        const auto t = edge.free_flow_time;
+        const auto f = data.edges[e].capacity;
+        const auto t = data.edges[e].free_flow_time;
 
         double max = 0.0;
         int64_t s_max = -1; // since source index is uint32_t
-        for (auto s : data.sources)
+        for (uint32_t s = 0; s < data.sources.size(); ++s)
         {
             const auto value = T(x, s, j) - T(x, s, i) - t;
             if (value > max)
@@ -183,7 +231,7 @@ TSDM::df(Point& p)
             }
         }
 
-        if (s_max > 0)
+        if (s_max >= 0)
         {
             T(g, s_max, j) += f;
             T(g, s_max, i) -= f;
@@ -193,5 +241,76 @@ TSDM::df(Point& p)
 
 #endif
 
+template <typename Real>
+void
+BasicTSDM<Real>::line_setup(const Vector<Real>& x, const Vector<Real>& dir)
+{
+    this->setup_line(x, dir);
 }
 
+template <typename Real>
+double
+BasicTSDM<Real>::line_f(double t, double* dphi)
+{
+    // Edges block of parallel evaluation
+    static const size_t EDGES_BLOCK = 256;
+
+    const auto& x = *line_x;
+    const auto& dir = *line_dir;
+    const size_t sources = data.sources.size();
+
+    auto block_f = [this, &x, &dir, t, dphi, sources](size_t begin, size_t end, size_t thread)
+    {
+        auto w = this->threads() > 1 ? thread_work[thread].data() : work.data();
+
+        std::pair<double, double> sums(0.0, 0.0);
+        for (size_t e = begin; e < end; ++e)
+        {
+            const auto i = edge_index[e].source;
+            const auto j = edge_index[e].target;
+            const auto f = data.edges[e].capacity;
+
+            const auto max = kernels::line_scaled_diff_max(
+                &T(x, 0, j), &T(x, 0, i), &T(dir, 0, j), &T(dir, 0, i), row_stride, sources,
+                t, data.edges[e].free_flow_time, 1.0, w);
+            sums.first += f * max;
+
+            // df() scatters f into all sources where the max is reached
+            if (dphi && max > 0.0)
+            {
+                for (size_t s = 0; s < sources; ++s)
+                {
+                    if (w[s] == max)
+                    {
+                        sums.second += f * (T(dir, s, j) - T(dir, s, i));
+                    }
+                }
+            }
+        }
+
+        return sums;
+    };
+
+    auto add = [](const std::pair<double, double>& a, const std::pair<double, double>& b)
+    {
+        return std::make_pair(a.first + b.first, a.second + b.second);
+    };
+
+    const auto sums = ThreadPool::shared().parallel_reduce(
+        0, data.edges.size(), EDGES_BLOCK, std::make_pair(0.0, 0.0), block_f, add, this->threads());
+
+    double trips_dphi;
+    const auto f = sums.first + this->line_trips_f(t, &trips_dphi);
+
+    if (dphi)
+    {
+        *dphi = sums.second + trips_dphi;
+    }
+
+    return f;
+}
+
+template struct BasicTSDM<double>;
+template struct BasicTSDM<float>;
+
+}
@@ -5,9 +5,12 @@
 namespace transport
 {
 
-struct TSDM : public SDM
+template <typename Real>
+struct BasicTSDM : public BasicSDM<Real>
 {
-    TSDM(const String& path, const String& name);
+    using Point = BasicPoint<Real>;
+
+    BasicTSDM(const String& path, const String& name, Layout layout = Layout::SourceMajor);
 
     void
     f(Point& p) override;
@@ -15,8 +18,32 @@ struct TSDM : public SDM
     void
     df(Point& p) override;
 
+    void
+    fdf(Point& p) override;
+
+    void
+    line_setup(const Vector<Real>& x, const Vector<Real>& dir) override;
+
+    // dphi is the one-sided derivative of the same subgradient as df() gives
+    double
+    line_f(double t, double* dphi = nullptr) override;
+
     void
     restore_flow(Point& point);
+
+protected:
+    using BasicSDM<Real>::data;
+    using BasicSDM<Real>::work;
+    using BasicSDM<Real>::row_stride;
+    using BasicSDM<Real>::edge_index;
+    using BasicSDM<Real>::trip_index;
+    using BasicSDM<Real>::T;
+    using BasicSDM<Real>::calc_exp_sum;
+    using BasicSDM<Real>::thread_work;
+    using BasicSDM<Real>::line_x;
+    using BasicSDM<Real>::line_dir;
 };
 
+using TSDM = BasicTSDM<double>;
+
 }
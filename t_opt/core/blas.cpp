@@ -0,0 +1,394 @@
+#include "blas.hpp"
+#include "blas_backend.hpp"
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+namespace t_opt
+{
+
+namespace blas
+{
+
+namespace
+{
+
+using backend::Kernels;
+
+// Long vectors are split into blocks of this size. Reductions are always summed by blocks in
+// the same order, so their results do not depend on the number of threads.
+const size_t BLOCK = 1 << 14;
+
+// Shorter vectors are processed by the calling thread only, as thread wake up costs more
+const size_t PARALLEL_MIN_SIZE = 1 << 17;
+
+const Kernels*
+select_kernels()
+{
+#ifdef T_OPT_BLAS_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return backend::avx512_kernels();
+    }
+
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    {
+        return backend::avx2_kernels();
+    }
+#endif
+
+    return backend::scalar_kernels();
+}
+
+inline const Kernels&
+kernels()
+{
+    static const Kernels* k = select_kernels();
+    return *k;
+}
+
+// Maximum number of threads of the shared pool used by blas, see set_threads()
+size_t pool_threads = 1;
+
+inline bool
+use_pool(size_t n)
+{
+    return pool_threads > 1 && n >= PARALLEL_MIN_SIZE;
+}
+
+// Calls op(begin, count) for all blocks of [0, n) in parallel
+template <typename Op>
+void
+parallel_blocks(size_t n, const Op& op)
+{
+    ThreadPool::shared().parallel_for(0, n, BLOCK, [&op](size_t begin, size_t end, size_t)
+    {
+        op(begin, end - begin);
+    }, pool_threads);
+}
+
+// Calculates op(begin, count, partial) for blocks of [0, n), partial has size values, and
+// merges them in order into result with combine(result, partial)
+template <size_t size, typename Op, typename Combine>
+void
+reduce_blocks(size_t n, const Op& op, const Combine& combine, double* result)
+{
+    if (n <= BLOCK)
+    {
+        op(0, n, result);
+        return;
+    }
+
+    const auto blocks = (n + BLOCK - 1) / BLOCK;
+    std::vector<double> partials(blocks * size);
+
+    auto block_op = [n, &op, &partials](size_t b, size_t)
+    {
+        const auto begin = b * BLOCK;
+        op(begin, std::min(BLOCK, n - begin), &partials[b * size]);
+    };
+
+    if (use_pool(n))
+    {
+        ThreadPool::shared().run(blocks, block_op, pool_threads);
+    }
+    else
+    {
+        for (size_t b = 0; b < blocks; ++b)
+        {
+            block_op(b, 0);
+        }
+    }
+
+    std::copy(&partials[0], &partials[size], result);
+    for (size_t b = 1; b < blocks; ++b)
+    {
+        combine(result, &partials[b * size]);
+    }
+}
+
+// Single precision sums are accumulated in double precision
+
+double
+dot_f32(size_t n, const float* x, const float* y)
+{
+    double s[4] = {0.0, 0.0, 0.0, 0.0};
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        for (size_t k = 0; k < 4; ++k)
+        {
+            s[k] += double(x[i + k]) * double(y[i + k]);
+        }
+    }
+
+    for (; i < n; ++i)
+    {
+        s[0] += double(x[i]) * double(y[i]);
+    }
+
+    return (s[0] + s[1]) + (s[2] + s[3]);
+}
+
+void
+norms_f32(size_t n, const float* x, double* nrm)
+{
+    double a[4] = {0.0, 0.0, 0.0, 0.0};
+    double s[4] = {0.0, 0.0, 0.0, 0.0};
+    float m = 0.0f;
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        for (size_t k = 0; k < 4; ++k)
+        {
+            const double value = std::fabs(x[i + k]);
+            a[k] += value;
+            s[k] += value * value;
+            m = std::max(m, std::fabs(x[i + k]));
+        }
+    }
+
+    for (; i < n; ++i)
+    {
+        const double value = std::fabs(x[i]);
+        a[0] += value;
+        s[0] += value * value;
+        m = std::max(m, std::fabs(x[i]));
+    }
+
+    nrm[0] = (a[0] + a[1]) + (a[2] + a[3]);
+    nrm[1] = (s[0] + s[1]) + (s[2] + s[3]);
+    nrm[2] = m;
+}
+
+}
+
+void
+set_threads(size_t threads, bool pin)
+{
+    pool_threads = std::max<size_t>(threads, 1);
+    if (pool_threads > 1)
+    {
+        ThreadPool::reserve_shared(pool_threads, pin);
+    }
+}
+
+size_t
+threads()
+{
+    return pool_threads;
+}
+
+const char*
+backend_name()
+{
+    return kernels().name;
+}
+
+namespace detail
+{
+
+void
+scal(size_t n, double a, double* x)
+{
+    const auto& k = kernels();
+    if (use_pool(n))
+    {
+        parallel_blocks(n, [&](size_t i, size_t m) { k.scal(m, a, x + i); });
+        return;
+    }
+
+    k.scal(n, a, x);
+}
+
+void
+scal_copy(size_t n, double a, const double* x, double* y)
+{
+    const auto& k = kernels();
+    if (use_pool(n))
+    {
+        parallel_blocks(n, [&](size_t i, size_t m) { k.scal_copy(m, a, x + i, y + i); });
+        return;
+    }
+
+    k.scal_copy(n, a, x, y);
+}
+
+void
+copy(size_t n, const double* x, double* y)
+{
+    const auto& k = kernels();
+    if (use_pool(n))
+    {
+        parallel_blocks(n, [&](size_t i, size_t m) { k.copy(m, x + i, y + i); });
+        return;
+    }
+
+    k.copy(n, x, y);
+}
+
+void
+set_zero(size_t n, double* x)
+{
+    const auto& k = kernels();
+    if (use_pool(n))
+    {
+        parallel_blocks(n, [&](size_t i, size_t m) { k.set_zero(m, x + i); });
+        return;
+    }
+
+    k.set_zero(n, x);
+}
+
+void
+axpy(size_t n, double a, const double* x, double* y)
+{
+    const auto& k = kernels();
+    if (use_pool(n))
+    {
+        parallel_blocks(n, [&](size_t i, size_t m) { k.axpy(m, a, x + i, y + i); });
+        return;
+    }
+
+    k.axpy(n, a, x, y);
+}
+
+void
+axpyz(size_t n, double a, const double* x, const double* y, double* z)
+{
+    const auto& k = kernels();
+    if (use_pool(n))
+    {
+        parallel_blocks(n, [&](size_t i, size_t m) { k.axpyz(m, a, x + i, y + i, z + i); });
+        return;
+    }
+
+    k.axpyz(n, a, x, y, z);
+}
+
+void
+axpbyz(size_t n, double a, const double* x, double b, const double* y, double* z)
+{
+    const auto& k = kernels();
+    if (use_pool(n))
+    {
+        parallel_blocks(n, [&](size_t i, size_t m) { k.axpbyz(m, a, x + i, b, y + i, z + i); });
+        return;
+    }
+
+    k.axpbyz(n, a, x, b, y, z);
+}
+
+void
+xmy(size_t n, const double* x, double* y)
+{
+    const auto& k = kernels();
+    if (use_pool(n))
+    {
+        parallel_blocks(n, [&](size_t i, size_t m) { k.xmy(m, x + i, y + i); });
+        return;
+    }
+
+    k.xmy(n, x, y);
+}
+
+void
+xmyz(size_t n, const double* x, const double* y, double* z)
+{
+    const auto& k = kernels();
+    if (use_pool(n))
+    {
+        parallel_blocks(n, [&](size_t i, size_t m) { k.xmyz(m, x + i, y + i, z + i); });
+        return;
+    }
+
+    k.xmyz(n, x, y, z);
+}
+
+double
+dot(size_t n, const double* x, const double* y)
+{
+    const auto& k = kernels();
+
+    auto op = [&](size_t i, size_t m, double* partial)
+    {
+        *partial = k.dot(m, x + i, y + i);
+    };
+
+    auto combine = [](double* result, const double* partial)
+    {
+        *result += *partial;
+    };
+
+    double result;
+    reduce_blocks<1>(n, op, combine, &result);
+
+    return result;
+}
+
+void
+norms(size_t n, const double* x, double* nrm)
+{
+    const auto& k = kernels();
+
+    auto op = [&](size_t i, size_t m, double* partial)
+    {
+        k.norms(m, x + i, partial);
+    };
+
+    auto combine = [](double* result, const double* partial)
+    {
+        result[0] += partial[0];
+        result[1] += partial[1];
+        result[2] = std::max(result[2], partial[2]);
+    };
+
+    reduce_blocks<3>(n, op, combine, nrm);
+}
+
+double
+dot(size_t n, const float* x, const float* y)
+{
+    auto op = [&](size_t i, size_t m, double* partial)
+    {
+        *partial = dot_f32(m, x + i, y + i);
+    };
+
+    auto combine = [](double* result, const double* partial)
+    {
+        *result += *partial;
+    };
+
+    double result;
+    reduce_blocks<1>(n, op, combine, &result);
+
+    return result;
+}
+
+void
+norms(size_t n, const float* x, double* nrm)
+{
+    auto op = [&](size_t i, size_t m, double* partial)
+    {
+        norms_f32(m, x + i, partial);
+    };
+
+    auto combine = [](double* result, const double* partial)
+    {
+        result[0] += partial[0];
+        result[1] += partial[1];
+        result[2] = std::max(result[2], partial[2]);
+    };
+
+    reduce_blocks<3>(n, op, combine, nrm);
+}
+
+}
+
+}
+
+}
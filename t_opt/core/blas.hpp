@@ -8,97 +8,234 @@ namespace t_opt
 namespace blas
 {
 
+// Vector operations are done by kernels selected at startup for the host CPU (scalar, AVX2 or
+// AVX-512), see blas.cpp. Long vectors are processed by blocks, which are spread over at most
+// set_threads() threads of the shared ThreadPool.
+
+// Not thread safe, should be called before optimization, see ThreadPool for pin
+void
+set_threads(size_t threads, bool pin = false);
+
+size_t
+threads();
+
+// Name of the selected kernels
+const char*
+backend_name();
+
+namespace detail
+{
+
+void
+scal(size_t n, double a, double* x);
+
+void
+scal_copy(size_t n, double a, const double* x, double* y);
+
+void
+copy(size_t n, const double* x, double* y);
+
+void
+set_zero(size_t n, double* x);
+
+void
+axpy(size_t n, double a, const double* x, double* y);
+
+void
+axpyz(size_t n, double a, const double* x, const double* y, double* z);
+
+void
+axpbyz(size_t n, double a, const double* x, double b, const double* y, double* z);
+
+void
+xmy(size_t n, const double* x, double* y);
+
+void
+xmyz(size_t n, const double* x, const double* y, double* z);
+
+double
+dot(size_t n, const double* x, const double* y);
+
+void
+norms(size_t n, const double* x, double* nrm);
+
+double
+dot(size_t n, const float* x, const float* y);
+
+void
+norms(size_t n, const float* x, double* nrm);
+
+}
+
 inline void
 scal(double a, DVector& x)
 {
-    x *= a;
+    detail::scal(x.size(), a, x.data());
 }
 
 inline void
 copy(const DVector& src, DVector& dest)
 {
-    dest = src;
-//     std::memcpy(dest.data(), src.data(), src.size() * sizeof(double));
+    dest.resize(src.size());
+    detail::copy(src.size(), src.data(), dest.data());
 }
 
 inline void
 scal_copy(double a, const DVector& src, DVector& dest)
 {
-    dest = a * src;
+    dest.resize(src.size());
+    detail::scal_copy(src.size(), a, src.data(), dest.data());
 }
 
 inline void
 set_zero(DVector& x)
 {
-    x.setZero();
-//     std::memset(x.data(), 0, x.size() * sizeof(double));
+    detail::set_zero(x.size(), x.data());
 }
 
 inline void
 axpy(double a, const DVector& x, DVector& y)
 {
-    y += a * x;
-//     for (uint32_t i = 0; i < x.size(); ++i)
-//     {
-//         y[i] += a * x[i];
-//     }
+    detail::axpy(x.size(), a, x.data(), y.data());
 }
 
 inline void
 axpyz(double a, const DVector& x, const DVector& y, DVector& z)
 {
-    z = a * x + y;
-//     for (uint32_t i = 0; i < x.size(); ++i)
-//     {
-//         z[i] = a * x[i] + y[i];
-//     }
+    z.resize(x.size());
+    detail::axpyz(x.size(), a, x.data(), y.data(), z.data());
 }
 
 inline void
 axpbyz(double a, const DVector& x, double b, const DVector& y, DVector& z)
 {
-    z = a * x + b * y;
-//     for (uint32_t i = 0; i < x.size(); ++i)
-//     {
-//         z[i] = a * x[i] + b * y[i];
-//     }
+    z.resize(x.size());
+    detail::axpbyz(x.size(), a, x.data(), b, y.data(), z.data());
 }
 
+// y = x - y
 inline void
 xmy(const DVector& x, DVector& y)
 {
-    y = x - y;
+    detail::xmy(x.size(), x.data(), y.data());
 }
 
 inline void
 xmyz(const DVector& x, const DVector& y, DVector& z)
 {
-    z = x - y;
-//     for (uint32_t i = 0; i < x.size(); ++i)
-//     {
-//         z[i] = x[i] - y[i];
-//     }
+    z.resize(x.size());
+    detail::xmyz(x.size(), x.data(), y.data(), z.data());
 }
 
 inline double
 dot(const DVector& x, const DVector& y)
 {
-    return x.dot(y);
-
-//     // FIXME add vectorization/loop unrolling
-//     double d = 0.0;
-//     for (uint32_t i = 0; i < x.size(); ++i)
-//     {
-//         d += x[i] * y[i];
-//     }
-//     return d;
+    return detail::dot(x.size(), x.data(), y.data());
 }
 
 inline double
 nrm2(const DVector& x)
 {
+    // sum of squares is accurate enough unless it underflows or overflows
+    const auto nrm2_2 = dot(x, x);
+    if (nrm2_2 > 1e-280 && nrm2_2 < limits<double>::infinity())
+    {
+        return std::sqrt(nrm2_2);
+    }
+
     return x.stableNorm();
-//     return std::sqrt(dot(x, x));
+}
+
+// Calculates 1-norm, squared 2-norm and infinity norm of x in one pass
+inline void
+norms(const DVector& x, double& nrm_1, double& nrm2_2, double& nrm_inf)
+{
+    double nrm[3];
+    detail::norms(x.size(), x.data(), nrm);
+
+    nrm_1 = nrm[0];
+    nrm2_2 = nrm[1];
+    nrm_inf = nrm[2];
+}
+
+// Single precision versions, element-wise operations are done by Eigen, sums are accumulated
+// in double precision
+
+inline void
+scal(double a, FVector& x)
+{
+    x *= float(a);
+}
+
+inline void
+copy(const FVector& src, FVector& dest)
+{
+    dest = src;
+}
+
+inline void
+scal_copy(double a, const FVector& src, FVector& dest)
+{
+    dest = float(a) * src;
+}
+
+inline void
+set_zero(FVector& x)
+{
+    x.setZero();
+}
+
+inline void
+axpy(double a, const FVector& x, FVector& y)
+{
+    y += float(a) * x;
+}
+
+inline void
+axpyz(double a, const FVector& x, const FVector& y, FVector& z)
+{
+    z = float(a) * x + y;
+}
+
+inline void
+axpbyz(double a, const FVector& x, double b, const FVector& y, FVector& z)
+{
+    z = float(a) * x + float(b) * y;
+}
+
+inline void
+xmy(const FVector& x, FVector& y)
+{
+    y = x - y;
+}
+
+inline void
+xmyz(const FVector& x, const FVector& y, FVector& z)
+{
+    z = x - y;
+}
+
+inline double
+dot(const FVector& x, const FVector& y)
+{
+    return detail::dot(x.size(), x.data(), y.data());
+}
+
+inline double
+nrm2(const FVector& x)
+{
+    return std::sqrt(dot(x, x));
+}
+
+inline void
+norms(const FVector& x, double& nrm_1, double& nrm2_2, double& nrm_inf)
+{
+    double nrm[3];
+    detail::norms(x.size(), x.data(), nrm);
+
+    nrm_1 = nrm[0];
+    nrm2_2 = nrm[1];
+    nrm_inf = nrm[2];
 }
 
 inline void
@@ -0,0 +1,115 @@
+// Compiled with -mavx2 -mfma, see CMakeLists.txt
+#ifdef T_OPT_BLAS_X86
+
+#include "blas_kernels.hpp"
+
+#include <immintrin.h>
+
+namespace t_opt
+{
+
+namespace blas
+{
+
+namespace backend
+{
+
+namespace
+{
+
+struct Avx2
+{
+    using Type = __m256d;
+    static constexpr size_t SIZE = 4;
+
+    static inline Type
+    load(const double* p)
+    {
+        return _mm256_loadu_pd(p);
+    }
+
+    static inline void
+    store(double* p, Type v)
+    {
+        _mm256_storeu_pd(p, v);
+    }
+
+    static inline Type
+    set1(double a)
+    {
+        return _mm256_set1_pd(a);
+    }
+
+    static inline Type
+    zero()
+    {
+        return _mm256_setzero_pd();
+    }
+
+    static inline Type
+    add(Type a, Type b)
+    {
+        return _mm256_add_pd(a, b);
+    }
+
+    static inline Type
+    sub(Type a, Type b)
+    {
+        return _mm256_sub_pd(a, b);
+    }
+
+    static inline Type
+    mul(Type a, Type b)
+    {
+        return _mm256_mul_pd(a, b);
+    }
+
+    static inline Type
+    fmadd(Type a, Type b, Type c)
+    {
+        return _mm256_fmadd_pd(a, b, c);
+    }
+
+    static inline Type
+    abs(Type a)
+    {
+        return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a);
+    }
+
+    static inline Type
+    max(Type a, Type b)
+    {
+        return _mm256_max_pd(a, b);
+    }
+
+    static inline double
+    hsum(Type a)
+    {
+        const auto v = _mm_add_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+        return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+    }
+
+    static inline double
+    hmax(Type a)
+    {
+        const auto v = _mm_max_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+        return _mm_cvtsd_f64(_mm_max_sd(v, _mm_unpackhi_pd(v, v)));
+    }
+};
+
+}
+
+const Kernels*
+avx2_kernels()
+{
+    static const Kernels kernels = make_kernels<Avx2>("avx2");
+    return &kernels;
+}
+
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,125 @@
+// Compiled with -mavx512f, see CMakeLists.txt
+#ifdef T_OPT_BLAS_X86
+
+#include "blas_kernels.hpp"
+
+#include <immintrin.h>
+
+// GCC passes undefined vectors to _mm512_reduce_*() and other unmasked intrinsics and warns
+// about them when they are inlined into blas_kernels.hpp loops, the warnings are false positives
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+namespace t_opt
+{
+
+namespace blas
+{
+
+namespace backend
+{
+
+namespace
+{
+
+struct Avx512
+{
+    using Type = __m512d;
+    static constexpr size_t SIZE = 8;
+
+    static inline Type
+    load(const double* p)
+    {
+        return _mm512_loadu_pd(p);
+    }
+
+    static inline void
+    store(double* p, Type v)
+    {
+        _mm512_storeu_pd(p, v);
+    }
+
+    static inline Type
+    set1(double a)
+    {
+        return _mm512_set1_pd(a);
+    }
+
+    static inline Type
+    zero()
+    {
+        return _mm512_setzero_pd();
+    }
+
+    static inline Type
+    add(Type a, Type b)
+    {
+        return _mm512_add_pd(a, b);
+    }
+
+    static inline Type
+    sub(Type a, Type b)
+    {
+        return _mm512_sub_pd(a, b);
+    }
+
+    static inline Type
+    mul(Type a, Type b)
+    {
+        return _mm512_mul_pd(a, b);
+    }
+
+    static inline Type
+    fmadd(Type a, Type b, Type c)
+    {
+        return _mm512_fmadd_pd(a, b, c);
+    }
+
+    static inline Type
+    abs(Type a)
+    {
+        return _mm512_abs_pd(a);
+    }
+
+    static inline Type
+    max(Type a, Type b)
+    {
+        return _mm512_max_pd(a, b);
+    }
+
+    static inline double
+    hsum(Type a)
+    {
+        return _mm512_reduce_add_pd(a);
+    }
+
+    static inline double
+    hmax(Type a)
+    {
+        return _mm512_reduce_max_pd(a);
+    }
+};
+
+}
+
+const Kernels*
+avx512_kernels()
+{
+    static const Kernels kernels = make_kernels<Avx512>("avx512");
+    return &kernels;
+}
+
+}
+
+}
+
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+
+namespace t_opt
+{
+
+namespace blas
+{
+
+namespace backend
+{
+
+// Table of vector kernels for one instruction set, all of them work on raw arrays of n values.
+// Output array may be the same as an input one.
+struct Kernels
+{
+    const char* name;
+
+    void (*scal)(size_t n, double a, double* x);
+    void (*scal_copy)(size_t n, double a, const double* x, double* y);
+    void (*copy)(size_t n, const double* x, double* y);
+    void (*set_zero)(size_t n, double* x);
+
+    void (*axpy)(size_t n, double a, const double* x, double* y);
+    void (*axpyz)(size_t n, double a, const double* x, const double* y, double* z);
+    void (*axpbyz)(size_t n, double a, const double* x, double b, const double* y, double* z);
+    void (*xmy)(size_t n, const double* x, double* y);
+    void (*xmyz)(size_t n, const double* x, const double* y, double* z);
+
+    double (*dot)(size_t n, const double* x, const double* y);
+
+    // nrm[0] = sum |x_i|, nrm[1] = sum x_i^2, nrm[2] = max |x_i|
+    void (*norms)(size_t n, const double* x, double* nrm);
+};
+
+const Kernels*
+scalar_kernels();
+
+// Defined only for x86 targets, must be called only if the host CPU supports them
+const Kernels*
+avx2_kernels();
+
+const Kernels*
+avx512_kernels();
+
+}
+
+}
+
+}
@@ -0,0 +1,286 @@
+#pragma once
+
+// Generic kernels for blas_*.cpp files, every file instantiates them with its own vector type V:
+//
+//     struct V
+//     {
+//         using Type = ...;
+//         static constexpr size_t SIZE = ...; // values per vector
+//
+//         load(p), store(p, v), set1(a), zero(), add(a, b), sub(a, b), mul(a, b),
+//         fmadd(a, b, c) = a * b + c, abs(a), max(a, b), hsum(a), hmax(a)
+//     };
+//
+// Everything here has internal linkage, so code compiled for different instruction sets is never
+// merged by the linker.
+
+#include "blas_backend.hpp"
+
+namespace t_opt
+{
+
+namespace blas
+{
+
+namespace backend
+{
+
+namespace
+{
+
+template <class V>
+struct Impl
+{
+    using Type = typename V::Type;
+
+    static void
+    scal(size_t n, double a, double* x)
+    {
+        const auto va = V::set1(a);
+
+        size_t i = 0;
+        for (; i + V::SIZE <= n; i += V::SIZE)
+        {
+            V::store(x + i, V::mul(va, V::load(x + i)));
+        }
+
+        for (; i < n; ++i)
+        {
+            x[i] *= a;
+        }
+    }
+
+    static void
+    scal_copy(size_t n, double a, const double* x, double* y)
+    {
+        const auto va = V::set1(a);
+
+        size_t i = 0;
+        for (; i + V::SIZE <= n; i += V::SIZE)
+        {
+            V::store(y + i, V::mul(va, V::load(x + i)));
+        }
+
+        for (; i < n; ++i)
+        {
+            y[i] = a * x[i];
+        }
+    }
+
+    static void
+    copy(size_t n, const double* x, double* y)
+    {
+        size_t i = 0;
+        for (; i + V::SIZE <= n; i += V::SIZE)
+        {
+            V::store(y + i, V::load(x + i));
+        }
+
+        for (; i < n; ++i)
+        {
+            y[i] = x[i];
+        }
+    }
+
+    static void
+    set_zero(size_t n, double* x)
+    {
+        const auto zero = V::zero();
+
+        size_t i = 0;
+        for (; i + V::SIZE <= n; i += V::SIZE)
+        {
+            V::store(x + i, zero);
+        }
+
+        for (; i < n; ++i)
+        {
+            x[i] = 0.0;
+        }
+    }
+
+    static void
+    axpy(size_t n, double a, const double* x, double* y)
+    {
+        const auto va = V::set1(a);
+
+        size_t i = 0;
+        for (; i + V::SIZE <= n; i += V::SIZE)
+        {
+            V::store(y + i, V::fmadd(va, V::load(x + i), V::load(y + i)));
+        }
+
+        for (; i < n; ++i)
+        {
+            y[i] += a * x[i];
+        }
+    }
+
+    static void
+    axpyz(size_t n, double a, const double* x, const double* y, double* z)
+    {
+        const auto va = V::set1(a);
+
+        size_t i = 0;
+        for (; i + V::SIZE <= n; i += V::SIZE)
+        {
+            V::store(z + i, V::fmadd(va, V::load(x + i), V::load(y + i)));
+        }
+
+        for (; i < n; ++i)
+        {
+            z[i] = a * x[i] + y[i];
+        }
+    }
+
+    static void
+    axpbyz(size_t n, double a, const double* x, double b, const double* y, double* z)
+    {
+        const auto va = V::set1(a);
+        const auto vb = V::set1(b);
+
+        size_t i = 0;
+        for (; i + V::SIZE <= n; i += V::SIZE)
+        {
+            V::store(z + i, V::fmadd(va, V::load(x + i), V::mul(vb, V::load(y + i))));
+        }
+
+        for (; i < n; ++i)
+        {
+            z[i] = a * x[i] + b * y[i];
+        }
+    }
+
+    static void
+    xmy(size_t n, const double* x, double* y)
+    {
+        xmyz(n, x, y, y);
+    }
+
+    static void
+    xmyz(size_t n, const double* x, const double* y, double* z)
+    {
+        size_t i = 0;
+        for (; i + V::SIZE <= n; i += V::SIZE)
+        {
+            V::store(z + i, V::sub(V::load(x + i), V::load(y + i)));
+        }
+
+        for (; i < n; ++i)
+        {
+            z[i] = x[i] - y[i];
+        }
+    }
+
+    static double
+    dot(size_t n, const double* x, const double* y)
+    {
+        // independent accumulators hide the latency of additions
+        Type s0 = V::zero();
+        Type s1 = V::zero();
+        Type s2 = V::zero();
+        Type s3 = V::zero();
+
+        size_t i = 0;
+        for (; i + 4 * V::SIZE <= n; i += 4 * V::SIZE)
+        {
+            s0 = V::fmadd(V::load(x + i), V::load(y + i), s0);
+            s1 = V::fmadd(V::load(x + i + V::SIZE), V::load(y + i + V::SIZE), s1);
+            s2 = V::fmadd(V::load(x + i + 2 * V::SIZE), V::load(y + i + 2 * V::SIZE), s2);
+            s3 = V::fmadd(V::load(x + i + 3 * V::SIZE), V::load(y + i + 3 * V::SIZE), s3);
+        }
+
+        for (; i + V::SIZE <= n; i += V::SIZE)
+        {
+            s0 = V::fmadd(V::load(x + i), V::load(y + i), s0);
+        }
+
+        double s = V::hsum(V::add(V::add(s0, s1), V::add(s2, s3)));
+        for (; i < n; ++i)
+        {
+            s += x[i] * y[i];
+        }
+
+        return s;
+    }
+
+    static void
+    norms(size_t n, const double* x, double* nrm)
+    {
+        Type a0 = V::zero();
+        Type a1 = V::zero();
+        Type s0 = V::zero();
+        Type s1 = V::zero();
+        Type m0 = V::zero();
+        Type m1 = V::zero();
+
+        size_t i = 0;
+        for (; i + 2 * V::SIZE <= n; i += 2 * V::SIZE)
+        {
+            const auto v0 = V::abs(V::load(x + i));
+            const auto v1 = V::abs(V::load(x + i + V::SIZE));
+
+            a0 = V::add(a0, v0);
+            a1 = V::add(a1, v1);
+            s0 = V::fmadd(v0, v0, s0);
+            s1 = V::fmadd(v1, v1, s1);
+            m0 = V::max(m0, v0);
+            m1 = V::max(m1, v1);
+        }
+
+        for (; i + V::SIZE <= n; i += V::SIZE)
+        {
+            const auto v0 = V::abs(V::load(x + i));
+
+            a0 = V::add(a0, v0);
+            s0 = V::fmadd(v0, v0, s0);
+            m0 = V::max(m0, v0);
+        }
+
+        double a = V::hsum(V::add(a0, a1));
+        double s = V::hsum(V::add(s0, s1));
+        double m = V::hmax(V::max(m0, m1));
+        for (; i < n; ++i)
+        {
+            const auto value = x[i] < 0.0 ? -x[i] : x[i];
+
+            a += value;
+            s += value * value;
+            m = value > m ? value : m;
+        }
+
+        nrm[0] = a;
+        nrm[1] = s;
+        nrm[2] = m;
+    }
+};
+
+template <class V>
+Kernels
+make_kernels(const char* name)
+{
+    Kernels k;
+
+    k.name = name;
+    k.scal = &Impl<V>::scal;
+    k.scal_copy = &Impl<V>::scal_copy;
+    k.copy = &Impl<V>::copy;
+    k.set_zero = &Impl<V>::set_zero;
+    k.axpy = &Impl<V>::axpy;
+    k.axpyz = &Impl<V>::axpyz;
+    k.axpbyz = &Impl<V>::axpbyz;
+    k.xmy = &Impl<V>::xmy;
+    k.xmyz = &Impl<V>::xmyz;
+    k.dot = &Impl<V>::dot;
+    k.norms = &Impl<V>::norms;
+
+    return k;
+}
+
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,106 @@
+#include "blas_kernels.hpp"
+
+namespace t_opt
+{
+
+namespace blas
+{
+
+namespace backend
+{
+
+namespace
+{
+
+struct Scalar
+{
+    using Type = double;
+    static constexpr size_t SIZE = 1;
+
+    static inline Type
+    load(const double* p)
+    {
+        return *p;
+    }
+
+    static inline void
+    store(double* p, Type v)
+    {
+        *p = v;
+    }
+
+    static inline Type
+    set1(double a)
+    {
+        return a;
+    }
+
+    static inline Type
+    zero()
+    {
+        return 0.0;
+    }
+
+    static inline Type
+    add(Type a, Type b)
+    {
+        return a + b;
+    }
+
+    static inline Type
+    sub(Type a, Type b)
+    {
+        return a - b;
+    }
+
+    static inline Type
+    mul(Type a, Type b)
+    {
+        return a * b;
+    }
+
+    static inline Type
+    fmadd(Type a, Type b, Type c)
+    {
+        return a * b + c;
+    }
+
+    static inline Type
+    abs(Type a)
+    {
+        return a < 0.0 ? -a : a;
+    }
+
+    static inline Type
+    max(Type a, Type b)
+    {
+        return a > b ? a : b;
+    }
+
+    static inline double
+    hsum(Type a)
+    {
+        return a;
+    }
+
+    static inline double
+    hmax(Type a)
+    {
+        return a;
+    }
+};
+
+}
+
+const Kernels*
+scalar_kernels()
+{
+    static const Kernels kernels = make_kernels<Scalar>("scalar");
+    return &kernels;
+}
+
+}
+
+}
+
+}
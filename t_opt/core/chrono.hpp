@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 
 namespace t_opt
 {
@@ -40,6 +41,14 @@ s(const Point& start)
     return s(start, now());
 }
 
+// Monotonic nanoseconds, cheap enough (vdso) for timing of hot paths
+inline uint64_t
+ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 }
 
 }
@@ -5,24 +5,25 @@
 namespace t_opt
 {
 
-class Point;
-class Problem;
-
 struct LineSearchProbe
 {
     double step;
     double f;
 };
 
-class LineSearchMethod
+template <typename T>
+class BasicLineSearchMethod
 {
 public:
+    using Scalar = T;
+    using Point = BasicPoint<T>;
+    using Problem = BasicProblem<T>;
 
     virtual void
     setup(Problem& problem) = 0;
 
     virtual LineSearchProbe
-    search(Problem& problem, const Point& point, const DVector& dir, bool dir_is_gradient, double start_step) = 0;
+    search(Problem& problem, const Point& point, const Vector<T>& dir, bool dir_is_gradient, double start_step) = 0;
 
 protected:
     inline double
@@ -32,4 +33,6 @@ protected:
     }
 };
 
+using LineSearchMethod = BasicLineSearchMethod<double>;
+
 }
@@ -0,0 +1,164 @@
+#include "log_writer.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace t_opt
+{
+
+constexpr size_t LogCell::TEXT_SIZE;
+constexpr size_t LogRecord::MAX_CELLS;
+
+// Writer thread sleeps for this time when the buffer is empty
+static const std::chrono::milliseconds IDLE_TIME(2);
+
+LogWriter::LogWriter(std::FILE* file, const char* delimiter, std::unique_ptr<TraceWriter> trace, size_t capacity)
+    : m_file(file)
+    , m_delimiter(delimiter)
+    , m_trace(std::move(trace))
+    , m_head(0)
+    , m_tail(0)
+    , m_flush(false)
+    , m_stop(false)
+    , m_dropped(0)
+{
+    // capacity is rounded up to a power of 2, so positions are wrapped by mask
+    size_t size = 1;
+    while (size < capacity)
+    {
+        size *= 2;
+    }
+
+    m_ring.resize(size);
+    m_mask = size - 1;
+    m_record.count = 0;
+
+    m_thread = std::thread(&LogWriter::run, this);
+}
+
+LogWriter::~LogWriter()
+{
+    m_stop.store(true, std::memory_order_release);
+    m_thread.join();
+
+    if (m_trace)
+    {
+        m_trace->flush();
+    }
+
+    if (m_dropped > 0)
+    {
+        printf("Log writer: %zu records were dropped, buffer is too small\n", m_dropped);
+    }
+
+    if (m_file)
+    {
+        std::fclose(m_file);
+    }
+}
+
+void
+LogWriter::push()
+{
+    const auto tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_head.load(std::memory_order_acquire) == m_ring.size())
+    {
+        m_dropped += 1;
+    }
+    else
+    {
+        auto& slot = m_ring[tail & m_mask];
+        slot.count = m_record.count;
+        std::copy(m_record.cells, m_record.cells + m_record.count, slot.cells);
+        m_tail.store(tail + 1, std::memory_order_release);
+    }
+
+    m_record.count = 0;
+}
+
+void
+LogWriter::flush()
+{
+    m_flush.store(true, std::memory_order_release);
+}
+
+void
+LogWriter::run()
+{
+    while (true)
+    {
+        // stop flag is read before the tail, so all records pushed before stop are written
+        const bool stop = m_stop.load(std::memory_order_acquire);
+
+        auto head = m_head.load(std::memory_order_relaxed);
+        const auto tail = m_tail.load(std::memory_order_acquire);
+
+        for (; head != tail; ++head)
+        {
+            write(m_ring[head & m_mask]);
+            m_head.store(head + 1, std::memory_order_release);
+        }
+
+        if (m_flush.exchange(false, std::memory_order_acq_rel) && m_file)
+        {
+            if (m_trace)
+            {
+                m_trace->flush();
+            }
+
+            std::fflush(m_file);
+        }
+
+        if (stop)
+        {
+            return;
+        }
+
+        std::this_thread::sleep_for(IDLE_TIME);
+    }
+}
+
+void
+LogWriter::write(const LogRecord& record)
+{
+    if (m_file == nullptr)
+    {
+        return;
+    }
+
+    if (m_trace)
+    {
+        m_trace->write(record);
+        return;
+    }
+
+    for (uint32_t i = 0; i < record.count; ++i)
+    {
+        const auto& cell = record.cells[i];
+
+        if (i > 0)
+        {
+            std::fputs(m_delimiter, m_file);
+        }
+
+        switch (cell.kind)
+        {
+            case LogCell::Kind::Text:
+                std::fprintf(m_file, "%.*s", (int)LogCell::TEXT_SIZE, cell.text);
+                break;
+
+            case LogCell::Kind::Size:
+                std::fprintf(m_file, "%zu", cell.size);
+                break;
+
+            case LogCell::Kind::Double:
+                std::fprintf(m_file, "%.*e", cell.precision, cell.number);
+                break;
+        }
+    }
+
+    std::fputs("\n", m_file);
+}
+
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace t_opt
+{
+
+class TraceWriter;
+
+// Column value of a log record, it is formatted by the writer thread
+struct LogCell
+{
+    enum class Kind : uint8_t
+    {
+        Text,
+        Size,
+        Double,
+    };
+
+    // longer texts are truncated
+    static constexpr size_t TEXT_SIZE = 24;
+
+    Kind kind;
+    uint8_t precision;
+
+    union
+    {
+        double number;
+        size_t size;
+        char text[TEXT_SIZE];
+    };
+};
+
+struct LogRecord
+{
+    static constexpr size_t MAX_CELLS = 24;
+
+    uint32_t count;
+    LogCell cells[MAX_CELLS];
+};
+
+// Writes log records into the file from a background thread, cells of a record are written as
+// one line separated by the delimiter, or encoded by the trace writer if it is given. Records are passed through a single producer / single
+// consumer lock-free ring buffer, so push() never waits for I/O: if the buffer is full, the
+// record is dropped (and counted).
+class LogWriter
+{
+public:
+    // Takes ownership of the file, null file discards all records
+    LogWriter(std::FILE* file, const char* delimiter, std::unique_ptr<TraceWriter> trace = nullptr,
+              size_t capacity = 1 << 12);
+
+    LogWriter(const LogWriter&) = delete;
+
+    LogWriter&
+    operator=(const LogWriter&) = delete;
+
+    // Writes all pushed records and closes the file
+    ~LogWriter();
+
+    // Record filled by the caller, it is cleared by push()
+    inline LogRecord&
+    record()
+    {
+        return m_record;
+    }
+
+    void
+    push();
+
+    // Asks writer thread to flush the file after all records pushed so far
+    void
+    flush();
+
+private:
+    void
+    run();
+
+    void
+    write(const LogRecord& record);
+
+    std::FILE* m_file;
+    const char* m_delimiter;
+    std::unique_ptr<TraceWriter> m_trace;
+
+    std::vector<LogRecord> m_ring;
+    size_t m_mask;
+
+    // m_head is advanced by the writer thread only, m_tail by the producer only
+    std::atomic<size_t> m_head;
+    std::atomic<size_t> m_tail;
+
+    std::atomic<bool> m_flush;
+    std::atomic<bool> m_stop;
+
+    size_t m_dropped;
+    LogRecord m_record;
+
+    std::thread m_thread;
+};
+
+}
@@ -1,46 +1,142 @@
 #include "logger.hpp"
 
 #include "types.hpp"
+#include "log_writer.hpp"
 #include "method.hpp"
+#include "timers.hpp"
+#include "trace.hpp"
+
+#include <cstring>
 
 namespace t_opt
 {
 
-Logger::Logger(const Method& method, LoggerDevice device, std::FILE* writer, const char* delimiter)
+namespace
+{
+
+// 0 for missing files
+long
+file_size(const String& file_name)
+{
+    auto file = std::fopen(file_name.c_str(), "rb");
+    if (file == nullptr)
+    {
+        return 0;
+    }
+
+    std::fseek(file, 0, SEEK_END);
+    const auto size = std::ftell(file);
+    std::fclose(file);
+
+    return size;
+}
+
+}
+
+Logger::Logger(const MethodBase& method, LoggerDevice device, std::FILE* writer, const char* delimiter)
     : m_method(method)
     , m_device(device)
     , m_writer(writer)
     , m_delimiter(delimiter)
+    , m_new_file(true)
 {
 }
 
 Logger
-Logger::stdout(const Method& method)
+Logger::stdout(const MethodBase& method)
 {
     return Logger(method, LoggerDevice::Stdout, ::stdout, " ");
 }
 
 Logger
-Logger::csv(const Method& method, bool resume)
+Logger::csv(const MethodBase& method, bool resume)
 {
     String file_name(method.name());
     std::transform(file_name.begin(), file_name.end(), file_name.begin(), ::tolower);
     file_name += ".log";
 
-    auto writer = resume ? fopen(file_name.c_str(), "a") : fopen(file_name.c_str(), "w"); // FIXME check result
+    const bool append = resume && file_size(file_name) > 0;
+    auto writer = append ? fopen(file_name.c_str(), "a") : fopen(file_name.c_str(), "w"); // FIXME check result
+
+    auto logger = Logger(method, LoggerDevice::CsvFile, nullptr, ";");
+    logger.m_log_writer.reset(new LogWriter(writer, ";"));
+    logger.m_new_file = append == false;
+
+    return logger;
+}
+
+Logger
+Logger::trace(const MethodBase& method, bool resume, bool delta)
+{
+    String file_name(method.name());
+    std::transform(file_name.begin(), file_name.end(), file_name.begin(), ::tolower);
+    file_name += ".trace";
+
+    std::FILE* writer = nullptr;
+    std::unique_ptr<TraceWriter> trace;
+
+    const bool append = resume && file_size(file_name) > 0;
+    if (append)
+    {
+        // chunks are decoded with flags and columns of the header, so they are taken from the file
+        TraceReader reader;
+        if (reader.open(file_name))
+        {
+            writer = fopen(file_name.c_str(), "ab"); // FIXME check result
+            trace.reset(new TraceWriter(writer, reader.flags(), reader.columns()));
+        }
+        else
+        {
+            printf("Can't append to '%s', trace is not written\n", file_name.c_str());
+        }
+    }
+    else
+    {
+        writer = fopen(file_name.c_str(), "wb"); // FIXME check result
+        trace.reset(new TraceWriter(writer, delta));
+    }
 
-    return Logger(method, LoggerDevice::CsvFile, writer, ";");
+    auto logger = Logger(method, LoggerDevice::CsvFile, nullptr, ";");
+    logger.m_log_writer.reset(new LogWriter(writer, ";", std::move(trace)));
+    logger.m_new_file = append == false;
+
+    return logger;
+}
+
+Logger
+Logger::none(const MethodBase& method)
+{
+    return Logger(method, LoggerDevice::CsvFile, nullptr, ";");
 }
 
+Logger::Logger(Logger&& other) = default;
+
+Logger::~Logger() = default;
+
 void
 Logger::flush()
 {
-    std::fflush(m_writer);
+    if (m_log_writer)
+    {
+        m_log_writer->flush();
+        return;
+    }
+
+    if (m_writer)
+    {
+        std::fflush(m_writer);
+    }
 }
 
 void
 Logger::put_new_line()
 {
+    if (m_log_writer)
+    {
+        m_log_writer->push();
+        return;
+    }
+
     std::fputs("\n", m_writer);
 }
 
@@ -62,15 +158,64 @@ Logger::put_carriage_return()
 void
 Logger::put_delimiter()
 {
+    if (m_log_writer)
+    {
+        // cells are delimited by the writer
+        return;
+    }
+
     std::fputs(m_delimiter, m_writer);
 }
 
 void
 Logger::put_value(const char* value)
 {
+    if (m_log_writer)
+    {
+        put_text(value);
+        return;
+    }
+
     std::fputs(value, m_writer);
 }
 
+void
+Logger::put_text(const char* text)
+{
+    auto& record = m_log_writer->record();
+    if (record.count < LogRecord::MAX_CELLS)
+    {
+        auto& cell = record.cells[record.count++];
+        cell.kind = LogCell::Kind::Text;
+        std::strncpy(cell.text, text, LogCell::TEXT_SIZE);
+    }
+}
+
+void
+Logger::put_size(size_t value)
+{
+    auto& record = m_log_writer->record();
+    if (record.count < LogRecord::MAX_CELLS)
+    {
+        auto& cell = record.cells[record.count++];
+        cell.kind = LogCell::Kind::Size;
+        cell.size = value;
+    }
+}
+
+void
+Logger::put_double(double value, int precision)
+{
+    auto& record = m_log_writer->record();
+    if (record.count < LogRecord::MAX_CELLS)
+    {
+        auto& cell = record.cells[record.count++];
+        cell.kind = LogCell::Kind::Double;
+        cell.precision = precision;
+        cell.number = value;
+    }
+}
+
 void
 Logger::put_method_name(LoggerMode mode)
 {
@@ -91,7 +236,7 @@ Logger::put_method_name(LoggerMode mode)
                     break;
 
                 case LoggerDevice::CsvFile :
-                    fprintf(m_writer, "%s", COLUMN_NAME);
+                    put_text(COLUMN_NAME);
                     break;
             }
             break;
@@ -104,7 +249,7 @@ Logger::put_method_name(LoggerMode mode)
                     break;
 
                 case LoggerDevice::CsvFile :
-                    fprintf(m_writer, "%s", m_method.name().c_str());
+                    put_text(m_method.name().c_str());
                     break;
             }
             break;
@@ -131,7 +276,7 @@ Logger::put_time(LoggerMode mode, double time)
                     break;
 
                 case LoggerDevice::CsvFile :
-                    fprintf(m_writer, "%s", COLUMN_NAME);
+                    put_text(COLUMN_NAME);
                     break;
             }
             break;
@@ -144,7 +289,7 @@ Logger::put_time(LoggerMode mode, double time)
                     break;
 
                 case LoggerDevice::CsvFile :
-                    fprintf(m_writer, "%.6e", time);
+                    put_double(time, 6);
                     break;
             }
             break;
@@ -169,7 +314,7 @@ Logger::put_iter(LoggerMode mode, size_t iter)
                     break;
 
                 case LoggerDevice::CsvFile :
-                    fprintf(m_writer, "%s", COLUMN_NAME);
+                    put_text(COLUMN_NAME);
                     break;
             }
             break;
@@ -182,15 +327,16 @@ Logger::put_iter(LoggerMode mode, size_t iter)
                     break;
 
                 case LoggerDevice::CsvFile :
-                    fprintf(m_writer, "%zu", iter);
+                    put_size(iter);
                     break;
             }
             break;
     };
 }
 
+template <typename T>
 void
-Logger::put_point(LoggerMode mode, const Point& point)
+Logger::put_point(LoggerMode mode, const BasicPoint<T>& point)
 {
     static const char* F_NAME = "f";
 
@@ -213,7 +359,7 @@ Logger::put_point(LoggerMode mode, const Point& point)
                     break;
 
                 case LoggerDevice::CsvFile :
-                    fprintf(m_writer, "%s", F_NAME);
+                    put_text(F_NAME);
                     if (m_method.use(ProblemProperty::Gradient))
                     {
                         put_g_norms(mode, point);
@@ -235,7 +381,7 @@ Logger::put_point(LoggerMode mode, const Point& point)
 
                 case LoggerDevice::CsvFile :
 //                     fprintf(m_writer, "%.*e", F_GN_PRECISION, point.f);
-                    fprintf(m_writer, "%.*e", 6, point.f);
+                    put_double(point.f, 6);
                     if (m_method.use(ProblemProperty::Gradient))
                     {
                         put_g_norms(mode, point);
@@ -270,11 +416,11 @@ Logger::put_state(LoggerMode mode, const State& state)
                     break;
 
                 case LoggerDevice::CsvFile :
-                    fprintf(m_writer, "%s", F_COLUMN_NAME);
+                    put_text(F_COLUMN_NAME);
                     if (m_method.use(ProblemProperty::Gradient))
                     {
                         put_delimiter();
-                        fprintf(m_writer, "%s", G_COLUMN_NAME);
+                        put_text(G_COLUMN_NAME);
                     }
                     break;
             }
@@ -293,11 +439,11 @@ Logger::put_state(LoggerMode mode, const State& state)
                     break;
 
                 case LoggerDevice::CsvFile :
-                    fprintf(m_writer, "%zu", state.f_count);
+                    put_size(state.f_count);
                     if (m_method.use(ProblemProperty::Gradient))
                     {
                         put_delimiter();
-                        fprintf(m_writer, "%zu", state.g_count);
+                        put_size(state.g_count);
                     }
                     break;
             }
@@ -324,7 +470,7 @@ Logger::put_ls_step(LoggerMode mode, double ls_step)
                     break;
 
                 case LoggerDevice::CsvFile :
-                    fprintf(m_writer, "%s", NAME);
+                    put_text(NAME);
                     break;
             }
             break;
@@ -337,7 +483,7 @@ Logger::put_ls_step(LoggerMode mode, double ls_step)
                     break;
 
                 case LoggerDevice::CsvFile :
-                    fprintf(m_writer, "%.*e", 6, ls_step);
+                    put_double(ls_step, 6);
                     break;
             }
             break;
@@ -345,7 +491,104 @@ Logger::put_ls_step(LoggerMode mode, double ls_step)
 }
 
 void
-Logger::put_g_norms(LoggerMode mode, const Point& point)
+Logger::put_gap(LoggerMode mode, double gap, double g_nrm2)
+{
+    // precisions of f and gradient norm columns
+    static const char* NAMES[] = {"PD_delta", "PD_g_nrm2"};
+    static const int PRECISIONS[] = {16, 6};
+
+    const double values[] = {gap, g_nrm2};
+    for (size_t i = 0; i < 2; ++i)
+    {
+        const int precision = PRECISIONS[i];
+        const int width = precision + 7;
+
+        put_delimiter();
+
+        switch (mode)
+        {
+            case LoggerMode::Header :
+                switch (m_device)
+                {
+                    case LoggerDevice::Stdout :
+                        fprintf(m_writer, " %-*s", width - 1, NAMES[i]);
+                        break;
+
+                    case LoggerDevice::CsvFile :
+                        put_text(NAMES[i]);
+                        break;
+                }
+                break;
+
+            case LoggerMode::Value :
+                switch (m_device)
+                {
+                    case LoggerDevice::Stdout :
+                        fprintf(m_writer, "% -*.*e", width, precision, values[i]);
+                        break;
+
+                    case LoggerDevice::CsvFile :
+                        put_double(values[i], 6);
+                        break;
+                }
+                break;
+        };
+    }
+}
+
+void
+Logger::put_timers(LoggerMode mode, const PhaseTimers& timers)
+{
+    static const int PRECISION = 3;
+    static const int WIDTH = PRECISION + 7;
+
+    char name[LogCell::TEXT_SIZE];
+
+    for (size_t i = 0; i <= PhaseTimers::PHASES; ++i)
+    {
+        // last column is the method time
+        const bool method = i == PhaseTimers::PHASES;
+
+        put_delimiter();
+
+        switch (mode)
+        {
+            case LoggerMode::Header :
+                snprintf(name, sizeof(name), "t_%s", method ? "method" : to_string(Phase(i)));
+                switch (m_device)
+                {
+                    case LoggerDevice::Stdout :
+                        fprintf(m_writer, "%*s", WIDTH, name);
+                        break;
+
+                    case LoggerDevice::CsvFile :
+                        put_text(name);
+                        break;
+                }
+                break;
+
+            case LoggerMode::Value :
+            {
+                const auto s = method ? timers.method_s() : timers[Phase(i)].s();
+                switch (m_device)
+                {
+                    case LoggerDevice::Stdout :
+                        fprintf(m_writer, "%*.*f", WIDTH, PRECISION, s);
+                        break;
+
+                    case LoggerDevice::CsvFile :
+                        put_double(s, 6);
+                        break;
+                }
+                break;
+            }
+        };
+    }
+}
+
+template <typename T>
+void
+Logger::put_g_norms(LoggerMode mode, const BasicPoint<T>& point)
 {
     static const char* NRM_1_NAME = "g_nrm_1";
     static const char* NRM_2_NAME = "g_nrm_2";
@@ -370,11 +613,11 @@ Logger::put_g_norms(LoggerMode mode, const Point& point)
                     break;
 
                 case LoggerDevice::CsvFile :
-                    fprintf(m_writer, "%s", NRM_1_NAME);
+                    put_text(NRM_1_NAME);
                     put_delimiter();
-                    fprintf(m_writer, "%s", NRM_2_NAME);
+                    put_text(NRM_2_NAME);
                     put_delimiter();
-                    fprintf(m_writer, "%s", NRM_INF_NAME);
+                    put_text(NRM_INF_NAME);
                     break;
             }
             break;
@@ -391,15 +634,18 @@ Logger::put_g_norms(LoggerMode mode, const Point& point)
                     break;
 
                 case LoggerDevice::CsvFile :
-                    fprintf(m_writer, "%.*e", NRM_PRECISION, point.g_nrm_1);
+                    put_double(point.g_nrm_1, NRM_PRECISION);
                     put_delimiter();
-                    fprintf(m_writer, "%.*e", NRM_PRECISION, point.g_nrm2);
+                    put_double(point.g_nrm2, NRM_PRECISION);
                     put_delimiter();
-                    fprintf(m_writer, "%.*e", NRM_PRECISION, point.g_nrm_inf);
+                    put_double(point.g_nrm_inf, NRM_PRECISION);
                     break;
             }
             break;
     };
 }
 
+template void Logger::put_point(LoggerMode mode, const Point& point);
+template void Logger::put_point(LoggerMode mode, const FPoint& point);
+
 }
@@ -2,14 +2,19 @@
 
 #include <cstdio>
 #include <cstdint>
+#include <memory>
 
 namespace t_opt
 {
 
-class Method;
-class Point;
+class MethodBase;
+class LogWriter;
+class PhaseTimers;
 struct State;
 
+template <typename T>
+class BasicPoint;
+
 enum class LoggerDevice : uint8_t
 {
     Stdout,
@@ -26,10 +31,23 @@ class Logger
 {
 public:
     static Logger
-    stdout(const Method& method);
+    stdout(const MethodBase& method);
+
+    // Csv lines are formatted and written by a background thread, see LogWriter
+    static Logger
+    csv(const MethodBase& method, bool resume);
 
+    // Same as csv, but writes binary trace (see trace.hpp), optionally delta compressed
     static Logger
-    csv(const Method& method, bool resume);
+    trace(const MethodBase& method, bool resume, bool delta);
+
+    // Writes nothing, used with LogFormat::None
+    static Logger
+    none(const MethodBase& method);
+
+    Logger(Logger&& other);
+
+    ~Logger();
 
     inline LoggerDevice
     device() const
@@ -37,6 +55,13 @@ public:
         return m_device;
     }
 
+    // File was created or empty, so it needs the header even when the log is resumed
+    inline bool
+    new_file() const
+    {
+        return m_new_file;
+    }
+
     void
     flush();
 
@@ -61,8 +86,10 @@ public:
     void
     put_iter(LoggerMode mode, size_t iter);
 
+    // defined for double and float points
+    template <typename T>
     void
-    put_point(LoggerMode mode, const Point& point);
+    put_point(LoggerMode mode, const BasicPoint<T>& point);
 
     void
     put_state(LoggerMode mode, const State& state);
@@ -70,17 +97,40 @@ public:
     void
     put_ls_step(LoggerMode mode, double ls_step);
 
+    // Primal-dual gap and infeasibility of the averaged dual point, see MethodSettings::gap_min
+    void
+    put_gap(LoggerMode mode, double gap, double g_nrm2);
+
+    // Total seconds of every phase and of the method itself (see PhaseTimers::method_s())
+    void
+    put_timers(LoggerMode mode, const PhaseTimers& timers);
+
 
 private:
-    Logger(const Method& method, LoggerDevice device, std::FILE* writer, const char* delimiter);
+    Logger(const MethodBase& method, LoggerDevice device, std::FILE* writer, const char* delimiter);
+
+    template <typename T>
+    void
+    put_g_norms(LoggerMode mode, const BasicPoint<T>& point);
+
+    // Csv cells of the current line
 
     void
-    put_g_norms(LoggerMode mode, const Point& point);
+    put_text(const char* text);
 
-    const Method& m_method;
+    void
+    put_size(size_t value);
+
+    void
+    put_double(double value, int precision);
+
+    const MethodBase& m_method;
     LoggerDevice m_device;
     std::FILE* m_writer;
     const char* m_delimiter;
+    bool m_new_file;
+
+    std::unique_ptr<LogWriter> m_log_writer;
 };
 
 }
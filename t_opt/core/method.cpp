@@ -8,8 +8,12 @@
 namespace t_opt
 {
 
-struct WrappedProblem : public Problem
+template <typename T>
+struct WrappedProblem : public BasicProblem<T>
 {
+    using Point = BasicPoint<T>;
+    using Problem = BasicProblem<T>;
+
     WrappedProblem(Problem& problem, State& state)
         : Problem(problem)
         , m_problem(problem)
@@ -20,6 +24,8 @@ struct WrappedProblem : public Problem
     inline void
     f(Point& p) override
     {
+        ScopedTimer timer(&m_state.timers, Phase::Function);
+
         m_problem.f(p);
         if (std::isfinite(p.f) == false)
         {
@@ -32,31 +38,75 @@ struct WrappedProblem : public Problem
         m_state.f_count += 1;
     }
 
+    void
+    f_batch(Point* const* points, size_t k) override
+    {
+        ScopedTimer timer(&m_state.timers, Phase::Function);
+
+        m_problem.f_batch(points, k);
+        for (size_t i = 0; i < k; ++i)
+        {
+            if (std::isfinite(points[i]->f) == false)
+            {
+                points[i]->f = limits<double>::max();
+            }
+        }
+
+        m_state.f_count += k;
+    }
+
     inline void
     df(Point& p) override
     {
-        blas::set_zero(p.g);
-        m_problem.df(p);
+        {
+            ScopedTimer timer(&m_state.timers, Phase::Gradient);
+            m_problem.df(p);
+        }
+        calc_g_norms(p);
 
-//         p.g_nrm2_2 = blas::dot(p.g, p.g);
-//         p.g_nrm2 = sqrt(p.g_nrm2_2);
+        m_state.g_count += 1;
+    }
 
-        p.g_nrm_1 = p.g_nrm2_2 = p.g_nrm_inf = 0.0;
-        for (size_t i = 0; i < size(); ++i)
+    inline void
+    fdf(Point& p) override
+    {
         {
-            auto value = p.g[i];
-            p.g_nrm2_2 += value * value;
-
-            value = std::fabs(value);
-            p.g_nrm_1 += value;
-            p.g_nrm_inf = std::max(p.g_nrm_inf, value);
+            ScopedTimer timer(&m_state.timers, Phase::FunctionGradient);
+            m_problem.fdf(p);
         }
-        p.g_nrm2 = sqrt(p.g_nrm2_2);
+        if (std::isfinite(p.f) == false)
+        {
+            p.f = limits<double>::max();
+        }
+        calc_g_norms(p);
 
-//         printf("norms = %e %e %e\n", p.g_nrm_1, p.g_nrm2, p.g_nrm_inf);
+        m_state.f_count += 1;
         m_state.g_count += 1;
     }
 
+    void
+    line_setup(const Vector<T>& x, const Vector<T>& dir) override
+    {
+        ScopedTimer timer(&m_state.timers, Phase::LineSetup);
+        m_problem.line_setup(x, dir);
+    }
+
+    // counted as f() calls
+    double
+    line_f(double t, double* dphi) override
+    {
+        ScopedTimer timer(&m_state.timers, Phase::Function);
+
+        auto f = m_problem.line_f(t, dphi);
+        if (std::isfinite(f) == false)
+        {
+            f = limits<double>::max();
+        }
+
+        m_state.f_count += 1;
+        return f;
+    }
+
     void
     dual_x(Point & p, Point & dual_p) override
     {
@@ -69,21 +119,34 @@ struct WrappedProblem : public Problem
         m_problem.dual_f(dual_p);
     }
 
+    void
+    last_dual_x(const Point& point, Point& dual_p) override
+    {
+        m_problem.last_dual_x(point, dual_p);
+    }
+
+    PhaseTimers*
+    timers() override
+    {
+        return &m_state.timers;
+    }
+
 private:
+    inline void
+    calc_g_norms(Point& p)
+    {
+        ScopedTimer timer(&m_state.timers, Phase::GradientNorms);
+
+        blas::norms(p.g, p.g_nrm_1, p.g_nrm2_2, p.g_nrm_inf);
+        p.g_nrm2 = sqrt(p.g_nrm2_2);
+
+//         printf("norms = %e %e %e\n", p.g_nrm_1, p.g_nrm2, p.g_nrm_inf);
+    }
+
     Problem& m_problem;
     State& m_state;
 };
 
-// FIXME make public, add to_string(), add reason + state tuple as optimize result
-enum class ExitReason
-{
-    NoRelaxation,
-    Iterations,
-    Time,
-    FunctionValue,
-    GradientNormValue,
-};
-
 String
 to_string(ExitReason reason)
 {
@@ -119,35 +182,67 @@ to_string(ExitReason reason)
             static const String s("gradient norm value");
             return s;
         }
+
+        case ExitReason::Progress:
+        {
+            static const String s("slow progress");
+            return s;
+        }
+
+        case ExitReason::DualityGap:
+        {
+            static const String s("duality gap");
+            return s;
+        }
+
+        case ExitReason::Error:
+        {
+            static const String s("error");
+            return s;
+        }
     }
 
     // -Wreturn-type warning fix
     return {};
 }
 
-Method::Method(String name, ProblemPropertyFlags properties)
+MethodBase::MethodBase(String name, ProblemPropertyFlags properties)
     : m_name(name)
     , m_properties(properties)
 {
 }
 
 void
-Method::before(Problem& /*problem*/, Point& /*point*/)
+MethodBase::log(Logger& /*logger*/, LoggerMode /*mode*/) const
 {
 }
 
-void
-Method::after(Problem& /*problem*/, Point& /*point*/)
+template <typename T>
+BasicMethod<T>::BasicMethod(String name, ProblemPropertyFlags properties)
+    : MethodBase(name, properties)
+    , m_gap_used(false)
+    , m_gap(limits<double>::quiet_NaN())
+    , m_gap_g_nrm2(limits<double>::quiet_NaN())
+    , m_gap_outdated(false)
+    , m_weight(0.0)
 {
 }
 
+template <typename T>
 void
-Method::log(Logger& /*logger*/, LoggerMode /*mode*/) const
+BasicMethod<T>::before(Problem& /*problem*/, Point& /*point*/)
 {
 }
 
+template <typename T>
 void
-Method::optimize(Problem& original_problem, Point& point, const MethodSettings& settings, State& state)
+BasicMethod<T>::after(Problem& /*problem*/, Point& /*point*/)
+{
+}
+
+template <typename T>
+ExitReason
+BasicMethod<T>::optimize(Problem& original_problem, Point& point, const MethodSettings& settings, State& state)
 {
     auto print_error = [this, &original_problem](ProblemProperty p)
     {
@@ -162,14 +257,14 @@ Method::optimize(Problem& original_problem, Point& point, const MethodSettings&
         if (original_problem.has(p) == false)
         {
             print_error(p);
-            return;
+            return ExitReason::Error;
         }
     }
 
     if (use(ProblemProperty::LipschitzConstant) && std::isnan(original_problem.L()))
     {
         print_error(ProblemProperty::LipschitzConstant);
-        return;
+        return ExitReason::Error;
     }
 
     if (settings.resume == false)
@@ -178,37 +273,66 @@ Method::optimize(Problem& original_problem, Point& point, const MethodSettings&
         state.f_count = state.g_count = 0;
         state.t_total = 0.0;
         state.iter_total = 0;
+        state.timers.reset();
     }
 
-    auto stdout_logger = Logger::stdout(*this);
-    auto csv_logger = Logger::csv(*this, settings.resume);
+    const bool print = settings.print;
+    const bool csv = settings.log_format != LogFormat::None;
 
-    auto problem = WrappedProblem(original_problem, state);
+    auto stdout_logger = Logger::stdout(*this);
+    auto csv_logger =
+        settings.log_format == LogFormat::Trace ? Logger::trace(*this, settings.resume, settings.log_delta) :
+        settings.log_format == LogFormat::Csv ? Logger::csv(*this, settings.resume) :
+        Logger::none(*this);
+
+    auto problem = WrappedProblem<T>(original_problem, state);
+
+    // dual points are averaged over one optimization, it costs a few vector passes per iteration
+    m_gap_used = problem.has(ProblemProperty::DualPoint) && (settings.gap_min > 0.0 || settings.log_gap);
+    m_gap = limits<double>::quiet_NaN();
+    m_gap_g_nrm2 = limits<double>::quiet_NaN();
+    m_gap_outdated = false;
+    m_weight = 0.0;
+    m_g_sum.resize(0);
+    m_dual.x.resize(0);
+    m_dual_sum.resize(0);
+    if (m_gap_used)
+    {
+        m_g_sum.setZero(point.x.size());
+        m_dual.x.resize(problem.dual_size());
+        m_dual_sum.setZero(problem.dual_size());
+    }
 
     auto t_0 = chrono::now();
     auto t_p = t_0;
     size_t iter = state.iter_total; // FIXME remove variable ?
 
-    problem.f(point);
     if (problem.has(ProblemProperty::Gradient))
     {
-        problem.df(point);
+        problem.fdf(point);
+    }
+    else
+    {
+        problem.f(point);
     }
 
     before(problem, point);
 
     auto t_i = chrono::s(t_0) + state.t_total;
 
-    log_all(stdout_logger, LoggerMode::Header, point, state, t_i, iter);
-    stdout_logger.put_new_line();
+    if (print)
+    {
+        log_all(stdout_logger, LoggerMode::Header, point, state, t_i, iter);
+        stdout_logger.put_new_line();
 
-    log_all(stdout_logger, LoggerMode::Value, point, state, t_i, iter);
-    stdout_logger.put_new_line();
+        log_all(stdout_logger, LoggerMode::Value, point, state, t_i, iter);
+        stdout_logger.put_new_line();
+    }
 
-    if (settings.resume == false)
+    if (csv && (settings.resume == false || csv_logger.new_file()))
     {
-        log_all(csv_logger, LoggerMode::Header, point, state, t_i, iter);
-        log_all(csv_logger, LoggerMode::Value, point, state, t_i, iter);
+        log_all(csv_logger, LoggerMode::Header, point, state, t_i, iter, settings.log_timers);
+        log_all(csv_logger, LoggerMode::Value, point, state, t_i, iter, settings.log_timers);
     }
 
     auto exit_reason = ExitReason::NoRelaxation;
@@ -216,6 +340,9 @@ Method::optimize(Problem& original_problem, Point& point, const MethodSettings&
     double Z = 1e-1;
     bool zb = false;
 
+    auto progress_f = point.f;
+    auto progress_iter = iter;
+
     while (true)
     {
         // check start value of f and g_nrm2 before running the method
@@ -232,15 +359,24 @@ Method::optimize(Problem& original_problem, Point& point, const MethodSettings&
             break;
         }
 
-        auto iteration_result = iteration(problem, point, iter);
+        bool iteration_result;
+        {
+            ScopedTimer timer(&state.timers, Phase::Iteration);
+            iteration_result = iteration(problem, point, iter);
+        }
         iter += 1;
 
         auto t = chrono::now();
         auto t_i = chrono::s(t_0, t) + state.t_total;
         auto t_p_i = chrono::s(t_p, t);
 
-        // TODO add settings.log_iterval_time ?
-        log_all(csv_logger, LoggerMode::Value, point, state, t_i, iter);
+        ScopedTimer log_timer(&state.timers, Phase::Log);
+
+        if (csv && iter % settings.log_interval == 0)
+        {
+            update_gap(problem, point);
+            log_all(csv_logger, LoggerMode::Value, point, state, t_i, iter, settings.log_timers);
+        }
 
         if (point.g_nrm_inf <= Z)
         {
@@ -248,10 +384,11 @@ Method::optimize(Problem& original_problem, Point& point, const MethodSettings&
             Z *= 0.1;
         }
 
-        if (zb || (t_p_i > settings.print_iterval_time))
+        if (print && (zb || (t_p_i > settings.print_iterval_time)))
         {
             t_p = t;
 
+            update_gap(problem, point);
             log_all(stdout_logger, LoggerMode::Value, point, state, t_i, iter);
 
             // FIXME add log flushing interval parameter ?
@@ -274,6 +411,28 @@ Method::optimize(Problem& original_problem, Point& point, const MethodSettings&
             break;
         }
 
+        if (settings.gap_min > 0.0 && m_gap_used)
+        {
+            update_gap(problem, point);
+            if (m_gap < settings.gap_min && m_gap_g_nrm2 < settings.gap_g_nrm2_min)
+            {
+                exit_reason = ExitReason::DualityGap;
+                break;
+            }
+        }
+
+        if (settings.progress_min > 0.0 && iter >= progress_iter + settings.progress_window)
+        {
+            if (progress_f - point.f < settings.progress_min * std::fabs(progress_f))
+            {
+                exit_reason = ExitReason::Progress;
+                break;
+            }
+
+            progress_f = point.f;
+            progress_iter = iter;
+        }
+
         if (iter >= settings.iter_max + state.iter_total) // FIXME integer overflow (see default value of iter_max)
         {
             exit_reason = ExitReason::Iterations;
@@ -289,21 +448,36 @@ Method::optimize(Problem& original_problem, Point& point, const MethodSettings&
 
     after(problem, point);
 
+    update_gap(problem, point);
+
 //     t_i = chrono::s(t_0);
 //     log_all(stdout_logger, LoggerMode::Value, point, state, t_i + state.t_total, iter);
     state.t_total += chrono::s(t_0);
     state.iter_total = iter;
-    log_all(stdout_logger, LoggerMode::Value, point, state, state.t_total, state.iter_total);
-    stdout_logger.put_new_line();
 
-    printf("Exit by: %s\n", to_string(exit_reason).c_str());
+    if (print)
+    {
+        log_all(stdout_logger, LoggerMode::Value, point, state, state.t_total, state.iter_total);
+        stdout_logger.put_new_line();
+
+        printf("Exit by: %s\n", to_string(exit_reason).c_str());
+
+        if (settings.print_timers)
+        {
+            state.timers.print();
+        }
+    }
 
     // FIXME add this into logger's destructor
     csv_logger.flush();
+
+    return exit_reason;
 }
 
+template <typename T>
 void
-Method::log_all(Logger& logger, LoggerMode mode, const Point& point, const State& state, double time, size_t iter)
+BasicMethod<T>::log_all(Logger& logger, LoggerMode mode, const Point& point, const State& state, double time, size_t iter,
+                        bool timers)
 {
     if (logger.device() == LoggerDevice::Stdout)
     {
@@ -322,10 +496,58 @@ Method::log_all(Logger& logger, LoggerMode mode, const Point& point, const State
 
     log(logger, mode);
 
+    if (timers)
+    {
+        logger.put_timers(mode, state.timers);
+    }
+
     if (logger.device() == LoggerDevice::CsvFile)
     {
         logger.put_new_line();
     }
 }
 
+template <typename T>
+void
+BasicMethod<T>::average_dual(Problem& problem, const Point& point, double weight)
+{
+    if (m_gap_used == false)
+    {
+        return;
+    }
+
+    m_weight += weight;
+    blas::axpy(weight, point.g, m_g_sum);
+
+    // m_dual.x is used as a temporary, it gets the average in update_gap()
+    problem.last_dual_x(point, m_dual);
+    m_dual_sum += weight * m_dual.x.template cast<double>();
+
+    m_gap_outdated = true;
+}
+
+template <typename T>
+void
+BasicMethod<T>::update_gap(Problem& problem, const Point& point)
+{
+    if (m_gap_outdated == false)
+    {
+        return;
+    }
+
+    m_gap_outdated = false;
+
+    // Lagrangian of the averaged dual point y is L(x, y) >= <g, x> - dual_f(y), where g is the
+    // averaged gradient. f(x) >= L(x, y) for every x, so the gap is not negative, and
+    // f(x) - f* <= f(x) - L(x*, y) <= gap + |g| * |x - x*|.
+    m_dual.x = (m_dual_sum * (1.0 / m_weight)).template cast<T>();
+    problem.dual_f(m_dual);
+
+    m_gap = point.f + m_dual.f - blas::dot(m_g_sum, point.x) / m_weight;
+    m_gap_g_nrm2 = blas::nrm2(m_g_sum) / m_weight;
+}
+
+template class BasicMethod<double>;
+template class BasicMethod<float>;
+
 }
@@ -1,16 +1,38 @@
 #pragma once
 
+#include "timers.hpp"
 #include "types.hpp"
 
 namespace t_opt
 {
 
-class Problem;
-
 class Logger;
 enum class LoggerMode : uint8_t;
 
-class LineSearchMethod;
+template <typename T>
+class BasicLineSearchMethod;
+
+enum class LogFormat : uint8_t
+{
+    Csv,
+    Trace,
+    None, // no log file
+};
+
+enum class ExitReason : uint8_t
+{
+    NoRelaxation,
+    Iterations,
+    Time,
+    FunctionValue,
+    GradientNormValue,
+    Progress,
+    DualityGap,
+    Error, // method can't be applied to the problem
+};
+
+String
+to_string(ExitReason reason);
 
 struct MethodSettings
 {
@@ -22,6 +44,34 @@ struct MethodSettings
 
     double print_iterval_time = 0.1;
 
+    // Progress, exit reason and timers are printed to stdout, disable it when several
+    // methods run in parallel
+    bool print = true;
+
+    // Csv log line (or trace row) is written every log_interval iterations
+    size_t log_interval = 1;
+
+    LogFormat log_format = LogFormat::Csv;
+    bool log_delta = true; // delta compression of trace
+
+    // Exit when f decreases by less than progress_min * |f| over progress_window iterations,
+    // disabled by default
+    double progress_min = 0.0;
+    size_t progress_window = 100;
+
+    // Exit when primal-dual gap f(x) + dual_f(y) - <g, x> of the averaged dual point y is below
+    // gap_min and y is nearly feasible: its infeasibility (norm of the averaged gradient g) is
+    // below gap_g_nrm2_min. Then f(x) - f* <= gap_min + gap_g_nrm2_min * |x - x*|. Disabled by
+    // default, the gap is known only for methods which average dual points (see average_dual())
+    // and problems with ProblemProperty::DualPoint. log_gap logs the gap without stopping on it.
+    double gap_min = 0.0;
+    double gap_g_nrm2_min = 1e-6;
+    bool log_gap = false;
+
+    // Phase timers are printed at exit, log_timers adds their totals to csv log
+    bool print_timers = true;
+    bool log_timers = false;
+
     bool resume = false;
 };
 
@@ -34,17 +84,21 @@ struct State
     double t_total = 0.0;
     size_t iter_total = 0;
 
+    PhaseTimers timers;
+
     State&
     operator+=(const State& other)
     {
         f_count += other.f_count;
         g_count += other.g_count;
+        timers += other.timers;
 
         return *this;
     }
 };
 
-class Method
+// Scalar type independent part of methods, used by loggers
+class MethodBase
 {
 public:
     inline const String&
@@ -59,11 +113,38 @@ public:
         return bool(m_properties & p);
     }
 
-    void
+protected:
+    MethodBase(String name, ProblemPropertyFlags properties);
+
+    virtual void
+    log(Logger& logger, LoggerMode mode) const;
+
+    String m_name;
+    ProblemPropertyFlags m_properties;
+};
+
+template <typename T>
+class BasicMethod : public MethodBase
+{
+public:
+    using Scalar = T;
+    using Point = BasicPoint<T>;
+    using Problem = BasicProblem<T>;
+
+    // FIXME add reason + state tuple as result ?
+    ExitReason
     optimize(Problem& problem, Point& point, const MethodSettings& settings, State& state);
 
+    // Weighted average of dual points of the last optimize(), empty unless the gap is used (see
+    // MethodSettings::gap_min)
+    inline const Point&
+    dual() const
+    {
+        return m_dual;
+    }
+
 protected:
-    Method(String name, ProblemPropertyFlags properties = ProblemPropertyFlags());
+    BasicMethod(String name, ProblemPropertyFlags properties = ProblemPropertyFlags());
 
     virtual void
     before(Problem& problem, Point& point);
@@ -74,14 +155,35 @@ protected:
     virtual bool
     iteration(Problem& problem, Point& point, size_t iter) = 0;
 
-    virtual void
-    log(Logger& logger, LoggerMode mode) const;
+    void
+    log_all(Logger& logger, LoggerMode mode, const Point& point, const State& state, double time, size_t iter,
+            bool timers = false);
 
+    // Adds the dual point of the last gradient evaluation (at point, its f and g should be up to
+    // date) into the weighted average of dual points. The averaged gradient is the infeasibility
+    // of this average. Does nothing unless the gap is used, see MethodSettings::gap_min.
     void
-    log_all(Logger& logger, LoggerMode mode, const Point& point, const State& state, double time, size_t iter);
+    average_dual(Problem& problem, const Point& point, double weight);
 
-    String m_name;
-    ProblemPropertyFlags m_properties;
+    // The gap and infeasibility are logged only if the gap is used, NaN while unknown
+    bool m_gap_used;
+    double m_gap;
+    double m_gap_g_nrm2;
+
+private:
+    // Recalculates the gap of point if dual points were averaged since the last call
+    void
+    update_gap(Problem& problem, const Point& point);
+
+    bool m_gap_outdated;
+    double m_weight;
+    Vector<T> m_g_sum;
+
+    Point m_dual;
+    DVector m_dual_sum;
 };
 
+using Method = BasicMethod<double>;
+using FMethod = BasicMethod<float>;
+
 }
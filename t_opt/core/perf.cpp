@@ -0,0 +1,159 @@
+#include "perf.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+#endif
+
+namespace t_opt
+{
+
+const char*
+to_string(PerfEvent event)
+{
+    switch (event)
+    {
+        case PerfEvent::Cycles:       return "cycles";
+        case PerfEvent::Instructions: return "instructions";
+        case PerfEvent::CacheMisses:  return "llc misses";
+        case PerfEvent::BranchMisses: return "branch misses";
+    }
+
+    // -Wreturn-type warning fix
+    return "";
+}
+
+#ifdef __linux__
+
+static int
+open_event(PerfEvent event)
+{
+    static const uint64_t CONFIG[PerfCounters::EVENTS] =
+    {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+    };
+
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = CONFIG[size_t(event)];
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    return int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+PerfCounters::PerfCounters()
+{
+    for (size_t i = 0; i < EVENTS; ++i)
+    {
+        m_fd[i] = open_event(PerfEvent(i));
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+    for (auto fd : m_fd)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+}
+
+void
+PerfCounters::start()
+{
+    for (auto fd : m_fd)
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void
+PerfCounters::stop()
+{
+    for (auto fd : m_fd)
+    {
+        if (fd >= 0)
+        {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+}
+
+uint64_t
+PerfCounters::value(PerfEvent event) const
+{
+    const auto fd = m_fd[size_t(event)];
+
+    uint64_t value = 0;
+    if (fd < 0 || read(fd, &value, sizeof(value)) != sizeof(value))
+    {
+        return 0;
+    }
+
+    return value;
+}
+
+#else
+
+PerfCounters::PerfCounters()
+{
+    for (auto& fd : m_fd)
+    {
+        fd = -1;
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+}
+
+void
+PerfCounters::start()
+{
+}
+
+void
+PerfCounters::stop()
+{
+}
+
+uint64_t
+PerfCounters::value(PerfEvent /*event*/) const
+{
+    return 0;
+}
+
+#endif
+
+bool
+PerfCounters::any() const
+{
+    for (auto fd : m_fd)
+    {
+        if (fd >= 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace t_opt
+{
+
+enum class PerfEvent : uint8_t
+{
+    Cycles,
+    Instructions,
+    CacheMisses, // last level cache
+    BranchMisses,
+};
+
+const char*
+to_string(PerfEvent event);
+
+// Hardware counters of the calling thread (perf_event_open, user space only). Every event is
+// opened separately, events which are not supported by the kernel, the CPU or the permissions
+// (see /proc/sys/kernel/perf_event_paranoid) are unavailable, the others still work. On
+// non-Linux systems all events are unavailable.
+class PerfCounters
+{
+public:
+    static constexpr size_t EVENTS = size_t(PerfEvent::BranchMisses) + 1;
+
+    PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+
+    PerfCounters&
+    operator=(const PerfCounters&) = delete;
+
+    ~PerfCounters();
+
+    inline bool
+    available(PerfEvent event) const
+    {
+        return m_fd[size_t(event)] >= 0;
+    }
+
+    // true if at least one event is available
+    bool
+    any() const;
+
+    // Resets and starts all available counters
+    void
+    start();
+
+    void
+    stop();
+
+    // Value counted between start() and stop(), 0 for unavailable events
+    uint64_t
+    value(PerfEvent event) const;
+
+private:
+    int m_fd[EVENTS];
+};
+
+}
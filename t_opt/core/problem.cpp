@@ -1,14 +1,50 @@
 #include "problem.hpp"
+#include "thread_pool.hpp"
 
 namespace t_opt
 {
 
-Problem::Problem(const String& name, size_t size, ProblemPropertyFlags properties)
+template <typename T>
+BasicProblem<T>::BasicProblem(const String& name, size_t size, ProblemPropertyFlags properties)
     : m_name(name)
     , m_size(size)
+    , m_dual_size(0)
     , m_l(limits<double>::quiet_NaN())
     , m_properties(properties)
+    , m_threads(1)
 {
 }
 
+template <typename T>
+void
+BasicProblem<T>::fdf(Point& p)
+{
+    f(p);
+    df(p);
+}
+
+template <typename T>
+void
+BasicProblem<T>::f_batch(Point* const* points, size_t k)
+{
+    for (size_t i = 0; i < k; ++i)
+    {
+        f(*points[i]);
+    }
+}
+
+template <typename T>
+void
+BasicProblem<T>::set_threads(size_t threads, bool pin)
+{
+    m_threads = std::max<size_t>(threads, 1);
+    if (m_threads > 1)
+    {
+        ThreadPool::reserve_shared(m_threads, pin);
+    }
+}
+
+template class BasicProblem<double>;
+template class BasicProblem<float>;
+
 }
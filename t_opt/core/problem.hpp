@@ -5,9 +5,17 @@
 namespace t_opt
 {
 
-class Problem
+class PhaseTimers;
+
+// Problem with iterates of scalar type T. Single precision problems (FProblem) halve memory
+// traffic of large iterates, they are good enough for rough (about 1e-4 relative) solutions.
+template <typename T>
+class BasicProblem
 {
 public:
+    using Scalar = T;
+    using Point = BasicPoint<T>;
+
     inline const String&
     name() const
     {
@@ -41,9 +49,34 @@ public:
     virtual void
     f(Point& p) = 0;
 
+    // Writes the whole gradient into p.g, its previous content is undefined
     virtual void
     df(Point& p) = 0;
 
+    // Calculates both function value and gradient at the same point. Problems which share
+    // intermediate results between f() and df() should override it.
+    virtual void
+    fdf(Point& p);
+
+    // Calculates f() of k points. Problems which can share work between points (e.g. walk their
+    // data once) should override it.
+    virtual void
+    f_batch(Point* const* points, size_t k);
+
+    // Evaluation along the line x + t * dir for problems with ProblemProperty::LineEvaluation.
+    // line_setup() precomputes per direction data once, then line_f(t) returns f(x + t * dir)
+    // without forming the point, which makes line search probes much cheaper. If dphi is not
+    // null, the directional derivative <df(x + t * dir), dir> is written into it.
+
+    virtual void
+    line_setup(const Vector<T>& /*x*/, const Vector<T>& /*dir*/) {}
+
+    virtual double
+    line_f(double /*t*/, double* /*dphi*/ = nullptr)
+    {
+        return limits<double>::quiet_NaN();
+    }
+
     virtual void // FIXME remove
     emoe(Point& point) {};
 
@@ -53,15 +86,61 @@ public:
     virtual void
     dual_f(Point& dual_p) {}
 
+    // Dual point of the last df() or fdf() call for problems with ProblemProperty::DualPoint,
+    // point is the argument of this call with up to date f and g. It's recovered from the same
+    // terms as the gradient, so it costs much less than dual_x().
+    virtual void
+    last_dual_x(const Point& /*point*/, Point& /*dual_p*/) {}
+
+    // Estimated bytes moved between memory and CPU by one call, used by speed_test() to
+    // report achieved bandwidth. 0 means unknown.
+
+    virtual double
+    f_bytes() const
+    {
+        return 0.0;
+    }
+
+    virtual double
+    df_bytes() const
+    {
+        return 0.0;
+    }
+
+    virtual double
+    fdf_bytes() const
+    {
+        return f_bytes() + df_bytes();
+    }
+
+    // Sets the maximum number of threads of the shared ThreadPool used by evaluation of problems
+    // which support it, 1 (default) means serial one. Not thread safe, see ThreadPool for pin.
+    virtual void
+    set_threads(size_t threads, bool pin = false);
+
+    inline size_t
+    threads() const
+    {
+        return m_threads;
+    }
+
+    // Timers of the running method, see ScopedTimer
+    virtual PhaseTimers*
+    timers()
+    {
+        return nullptr;
+    }
+
 protected:
-    Problem(const Problem& problem) = default;
-    Problem(const String& name, size_t size, ProblemPropertyFlags properties = ProblemPropertyFlags());
+    BasicProblem(const BasicProblem& problem) = default;
+    BasicProblem(const String& name, size_t size, ProblemPropertyFlags properties = ProblemPropertyFlags());
 
     String m_name;
     size_t m_size;
     size_t m_dual_size;
     double m_l;
     ProblemPropertyFlags m_properties;
+    size_t m_threads;
 };
 
 }
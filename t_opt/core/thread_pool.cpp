@@ -0,0 +1,315 @@
+#include "thread_pool.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <limits>
+
+namespace t_opt
+{
+
+namespace
+{
+
+// Pool which runs a task on the current thread, tasks started from it are nested
+thread_local const ThreadPool* current_pool = nullptr;
+
+inline uint64_t
+pack(uint64_t begin, uint64_t end)
+{
+    return begin << 32 | end;
+}
+
+inline uint64_t
+range_begin(uint64_t value)
+{
+    return value >> 32;
+}
+
+inline uint64_t
+range_end(uint64_t value)
+{
+    return value & 0xffffffffu;
+}
+
+std::unique_ptr<ThreadPool>&
+shared_pool()
+{
+    static std::unique_ptr<ThreadPool> pool(new ThreadPool(std::max(1u, std::thread::hardware_concurrency())));
+    return pool;
+}
+
+}
+
+ThreadPool::ThreadPool(size_t threads, bool pin)
+    : m_pin(pin)
+    , m_ranges(new Range[std::max<size_t>(threads, 1)])
+    , m_task(nullptr)
+    , m_threads(0)
+    , m_busy(false)
+    , m_cancel(false)
+    , m_active(0)
+    , m_generation(0)
+    , m_stop(false)
+{
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i)
+    {
+        m_ranges[i].value = 0;
+    }
+
+    if (pin)
+    {
+        pin_thread(0);
+    }
+
+    for (size_t i = 1; i < threads; ++i)
+    {
+        m_workers.emplace_back([this, i, pin]()
+        {
+            if (pin)
+            {
+                pin_thread(i);
+            }
+            worker(i);
+        });
+    }
+}
+
+ThreadPool&
+ThreadPool::shared()
+{
+    return *shared_pool();
+}
+
+void
+ThreadPool::reserve_shared(size_t threads, bool pin)
+{
+    auto& pool = shared_pool();
+    if (pool->size() < threads || (pin && !pool->pinned()))
+    {
+        threads = std::max(threads, pool->size());
+        pin = pin || pool->pinned();
+
+        pool.reset();
+        pool.reset(new ThreadPool(threads, pin));
+    }
+}
+
+void
+ThreadPool::pin_thread(size_t thread)
+{
+#ifdef __linux__
+    static const cpu_set_t allowed = []()
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        sched_getaffinity(0, sizeof(set), &set);
+        return set;
+    }();
+
+    const size_t count = CPU_COUNT(&allowed);
+    if (count == 0)
+    {
+        return;
+    }
+
+    // thread-th allowed cpu
+    size_t index = thread % count;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+    {
+        if (CPU_ISSET(cpu, &allowed) && index-- == 0)
+        {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            return;
+        }
+    }
+#else
+    (void)thread;
+#endif
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_start.notify_all();
+
+    for (auto& w : m_workers)
+    {
+        w.join();
+    }
+}
+
+void
+ThreadPool::run(size_t count, const Task& task, size_t threads)
+{
+    threads = std::min(threads == 0 ? size() : threads, size());
+    threads = std::min(threads, count);
+
+    // m_busy is taken last, as it should be released by this call
+    if (threads <= 1 || current_pool != nullptr || count > std::numeric_limits<uint32_t>::max()
+        || m_busy.exchange(true))
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            task(i, 0);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_threads = threads;
+        m_cancel = false;
+        m_error = nullptr;
+        m_active = threads - 1;
+        for (size_t t = 0; t < threads; ++t)
+        {
+            m_ranges[t].value = pack(count * t / threads, count * (t + 1) / threads);
+        }
+        m_generation += 1;
+    }
+    m_start.notify_all();
+
+    current_pool = this;
+    execute(0);
+    current_pool = nullptr;
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_active == 0; });
+        m_task = nullptr;
+        error = m_error;
+        m_error = nullptr;
+    }
+    m_busy = false;
+
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+void
+ThreadPool::worker(size_t thread)
+{
+    current_pool = this;
+
+    size_t generation = 0;
+    while (true)
+    {
+        size_t threads;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [this, generation] { return m_stop || m_generation != generation; });
+            if (m_stop)
+            {
+                return;
+            }
+            generation = m_generation;
+            threads = m_threads;
+        }
+
+        // threads above the limit of the run sleep through it
+        if (thread >= threads)
+        {
+            continue;
+        }
+
+        execute(thread);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_active -= 1;
+            if (m_active == 0)
+            {
+                m_done.notify_one();
+            }
+        }
+    }
+}
+
+bool
+ThreadPool::pop(size_t thread, size_t& task)
+{
+    auto& range = m_ranges[thread].value;
+
+    auto value = range.load();
+    while (range_begin(value) < range_end(value))
+    {
+        if (range.compare_exchange_weak(value, pack(range_begin(value) + 1, range_end(value))))
+        {
+            task = range_begin(value);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool
+ThreadPool::steal(size_t thread)
+{
+    // the own range is empty here, other threads don't touch it until it is refilled
+    for (size_t k = 1; k < m_threads; ++k)
+    {
+        auto& range = m_ranges[(thread + k) % m_threads].value;
+
+        auto value = range.load();
+        while (range_begin(value) < range_end(value))
+        {
+            const auto begin = range_begin(value);
+            const auto end = range_end(value);
+            const auto middle = begin + (end - begin) / 2;
+
+            if (range.compare_exchange_weak(value, pack(begin, middle)))
+            {
+                m_ranges[thread].value = pack(middle, end);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void
+ThreadPool::execute(size_t thread)
+{
+    try
+    {
+        size_t task;
+        while (!m_cancel)
+        {
+            if (pop(thread, task))
+            {
+                (*m_task)(task, thread);
+            }
+            else if (!steal(thread))
+            {
+                break;
+            }
+        }
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_error)
+        {
+            m_error = std::current_exception();
+        }
+        // skip remaining tasks
+        m_cancel = true;
+    }
+}
+
+}
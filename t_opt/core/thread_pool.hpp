@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace t_opt
+{
+
+// Fixed size pool of worker threads for fork-join loops. The calling thread takes part in every
+// run() as thread 0, so a pool of size 1 has no workers.
+//
+// Tasks of a run are split into contiguous ranges, one per thread. A thread takes tasks from the
+// front of its own range, and when it is empty steals the upper half of the range of another
+// thread, so uneven tasks are balanced without a shared counter.
+//
+// Problems, blas, the TNTP loader and tools share one pool (see shared()). Nested runs (from a
+// task of any pool) and runs of a pool which is busy with another caller are done serially by
+// the calling thread as thread 0, so a batch of parallel solves doesn't oversubscribe CPUs.
+class ThreadPool
+{
+public:
+    using Task = std::function<void(size_t task, size_t thread)>;
+
+    // With pin thread i (the calling one is 0) is bound to the i-th CPU allowed for the
+    // process (wrapping around), it keeps timings of scaling benchmarks stable. Linux only.
+    explicit
+    ThreadPool(size_t threads, bool pin = false);
+
+    ThreadPool(const ThreadPool&) = delete;
+
+    ThreadPool&
+    operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool();
+
+    inline size_t
+    size() const
+    {
+        return m_workers.size() + 1;
+    }
+
+    inline bool
+    pinned() const
+    {
+        return m_pin;
+    }
+
+    // Pool of the process, created on first use with a thread per CPU
+    static ThreadPool&
+    shared();
+
+    // Recreates the shared pool if it has less than threads threads or it is not pinned while pin
+    // is requested. Not thread safe, should be called before optimization.
+    static void
+    reserve_shared(size_t threads, bool pin = false);
+
+    // Calls task(i, thread) for all i in [0, count) on at most threads threads (0 means all
+    // threads of the pool), thread is less than that limit. Returns when all tasks are done,
+    // rethrows the first exception of tasks, remaining tasks are skipped then.
+    void
+    run(size_t count, const Task& task, size_t threads = 0);
+
+    // Calls fn(first, last, thread) for consecutive ranges of [begin, end) of grain size
+    template <typename Fn>
+    void
+    parallel_for(size_t begin, size_t end, size_t grain, const Fn& fn, size_t threads = 0);
+
+    // Reduces fn(first, last, thread) values of grain size ranges of [begin, end) with
+    // reduce(a, b) in range order, so the result does not depend on the number of threads
+    template <typename T, typename Fn, typename Reduce>
+    T
+    parallel_reduce(size_t begin, size_t end, size_t grain, const T& init, const Fn& fn, const Reduce& reduce,
+                    size_t threads = 0);
+
+private:
+    // [begin, end) of tasks packed into one word, so it's taken or split by one CAS
+    struct Range
+    {
+        std::atomic<uint64_t> value;
+        char padding[64 - sizeof(std::atomic<uint64_t>)];
+    };
+
+    static void
+    pin_thread(size_t thread);
+
+    void
+    worker(size_t thread);
+
+    void
+    execute(size_t thread);
+
+    bool
+    pop(size_t thread, size_t& task);
+
+    bool
+    steal(size_t thread);
+
+    std::vector<std::thread> m_workers;
+    bool m_pin;
+
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+
+    // one per thread
+    std::unique_ptr<Range[]> m_ranges;
+
+    const Task* m_task;
+    size_t m_threads;
+    std::atomic<bool> m_busy;
+    std::atomic<bool> m_cancel;
+    std::exception_ptr m_error;
+
+    size_t m_active;
+    size_t m_generation;
+    bool m_stop;
+};
+
+// Scratch storage with a value per pool thread, indexed by the thread argument of tasks. Values
+// are padded to separate cache lines.
+template <typename T>
+class PerThread
+{
+public:
+    PerThread() = default;
+
+    PerThread(size_t threads, const T& value)
+    {
+        resize(threads, value);
+    }
+
+    inline void
+    resize(size_t threads, const T& value = T())
+    {
+        m_slots.assign(threads, Slot{value, {}});
+    }
+
+    inline size_t
+    size() const
+    {
+        return m_slots.size();
+    }
+
+    inline T&
+    operator[](size_t thread)
+    {
+        return m_slots[thread].value;
+    }
+
+    inline const T&
+    operator[](size_t thread) const
+    {
+        return m_slots[thread].value;
+    }
+
+private:
+    struct Slot
+    {
+        T value;
+        char padding[64];
+    };
+
+    std::vector<Slot> m_slots;
+};
+
+template <typename Fn>
+void
+ThreadPool::parallel_for(size_t begin, size_t end, size_t grain, const Fn& fn, size_t threads)
+{
+    if (begin >= end)
+    {
+        return;
+    }
+
+    const auto ranges = (end - begin + grain - 1) / grain;
+    run(ranges, [begin, end, grain, &fn](size_t r, size_t thread)
+    {
+        const auto first = begin + r * grain;
+        fn(first, std::min(end, first + grain), thread);
+    }, threads);
+}
+
+template <typename T, typename Fn, typename Reduce>
+T
+ThreadPool::parallel_reduce(size_t begin, size_t end, size_t grain, const T& init, const Fn& fn,
+                            const Reduce& reduce, size_t threads)
+{
+    if (begin >= end)
+    {
+        return init;
+    }
+
+    const auto ranges = (end - begin + grain - 1) / grain;
+    std::vector<T> partials(ranges, init);
+
+    run(ranges, [begin, end, grain, &fn, &partials](size_t r, size_t thread)
+    {
+        const auto first = begin + r * grain;
+        partials[r] = fn(first, std::min(end, first + grain), thread);
+    }, threads);
+
+    auto result = init;
+    for (const auto& partial : partials)
+    {
+        result = reduce(result, partial);
+    }
+
+    return result;
+}
+
+}
@@ -0,0 +1,136 @@
+#include "timers.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace t_opt
+{
+
+const char*
+to_string(Phase phase)
+{
+    switch (phase)
+    {
+        case Phase::Function:         return "f";
+        case Phase::Gradient:         return "df";
+        case Phase::FunctionGradient: return "fdf";
+        case Phase::GradientNorms:    return "g_norms";
+        case Phase::LineSetup:        return "line_setup";
+        case Phase::LineSearch:       return "line_search";
+        case Phase::Iteration:        return "iteration";
+        case Phase::Log:              return "log";
+    }
+
+    // -Wreturn-type warning fix
+    return "";
+}
+
+void
+PhaseStats::add(uint64_t ns)
+{
+    count += 1;
+    total_ns += ns;
+
+    size_t bucket = 0;
+    while ((ns >>= 1) != 0 && bucket + 1 < BUCKETS)
+    {
+        bucket += 1;
+    }
+
+    buckets[bucket] += 1;
+}
+
+double
+PhaseStats::quantile(double q) const
+{
+    const auto rank = uint64_t(q * count);
+
+    uint64_t sum = 0;
+    for (size_t i = 0; i < BUCKETS; ++i)
+    {
+        sum += buckets[i];
+        if (sum > rank)
+        {
+            return double(uint64_t(2) << i) * 1e-9;
+        }
+    }
+
+    return double(uint64_t(1) << BUCKETS) * 1e-9;
+}
+
+PhaseStats&
+PhaseStats::operator+=(const PhaseStats& other)
+{
+    count += other.count;
+    total_ns += other.total_ns;
+
+    for (size_t i = 0; i < BUCKETS; ++i)
+    {
+        buckets[i] += other.buckets[i];
+    }
+
+    return *this;
+}
+
+double
+PhaseTimers::method_s() const
+{
+    const auto problem_s =
+        (*this)[Phase::Function].s() +
+        (*this)[Phase::Gradient].s() +
+        (*this)[Phase::FunctionGradient].s() +
+        (*this)[Phase::GradientNorms].s() +
+        (*this)[Phase::LineSetup].s();
+
+    // problem calls made before the first iteration are counted too, hence the clamp
+    return std::max(0.0, (*this)[Phase::Iteration].s() - problem_s);
+}
+
+void
+PhaseTimers::reset()
+{
+    *this = PhaseTimers();
+}
+
+void
+PhaseTimers::print() const
+{
+    const auto iteration_s = std::max((*this)[Phase::Iteration].s(), 1e-12);
+
+    printf("%-12s %10s %10s %7s %10s %10s %10s %10s\n",
+           "phase", "count", "total, s", "share", "mean, us", "p50, us", "p90, us", "p99, us");
+
+    for (size_t i = 0; i < PHASES; ++i)
+    {
+        const auto& stats = m_stats[i];
+        if (stats.count == 0)
+        {
+            continue;
+        }
+
+        printf("%-12s %10llu %10.3f %6.1f%% %10.2f %10.2f %10.2f %10.2f\n",
+               to_string(Phase(i)),
+               (unsigned long long)stats.count,
+               stats.s(),
+               100.0 * stats.s() / iteration_s,
+               1e6 * stats.s() / stats.count,
+               1e6 * stats.quantile(0.5),
+               1e6 * stats.quantile(0.9),
+               1e6 * stats.quantile(0.99));
+    }
+
+    printf("%-12s %10s %10.3f %6.1f%%\n", "method", "", method_s(), 100.0 * method_s() / iteration_s);
+}
+
+PhaseTimers&
+PhaseTimers::operator+=(const PhaseTimers& other)
+{
+    for (size_t i = 0; i < PHASES; ++i)
+    {
+        m_stats[i] += other.m_stats[i];
+    }
+
+    return *this;
+}
+
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "chrono.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace t_opt
+{
+
+// Phases of the optimization hot path. LineSearch includes function evaluations made by
+// line search, the others are exclusive.
+enum class Phase : uint8_t
+{
+    Function,
+    Gradient,
+    FunctionGradient,
+    GradientNorms,
+    LineSetup,
+    LineSearch,
+    Iteration,
+    Log,
+};
+
+const char*
+to_string(Phase phase);
+
+struct PhaseStats
+{
+    // Durations histogram, bucket i counts durations in [2^i, 2^(i+1)) ns
+    static constexpr size_t BUCKETS = 40;
+
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t buckets[BUCKETS] = {};
+
+    void
+    add(uint64_t ns);
+
+    double
+    s() const
+    {
+        return total_ns * 1e-9;
+    }
+
+    // Upper bound of the bucket which holds q-quantile of durations, in seconds
+    double
+    quantile(double q) const;
+
+    PhaseStats&
+    operator+=(const PhaseStats& other);
+};
+
+class PhaseTimers
+{
+public:
+    static constexpr size_t PHASES = size_t(Phase::Log) + 1;
+
+    inline void
+    add(Phase phase, uint64_t ns)
+    {
+        m_stats[size_t(phase)].add(ns);
+    }
+
+    inline const PhaseStats&
+    operator[](Phase phase) const
+    {
+        return m_stats[size_t(phase)];
+    }
+
+    // Time of iterations not spent in problem calls: vector operations and logic of methods
+    double
+    method_s() const;
+
+    void
+    reset();
+
+    // Prints totals, shares of iterations time and percentiles of every phase, percentiles are
+    // upper bounds of histogram buckets
+    void
+    print() const;
+
+    PhaseTimers&
+    operator+=(const PhaseTimers& other);
+
+private:
+    PhaseStats m_stats[PHASES];
+};
+
+// Adds lifetime of the object to the phase, does nothing when timers is nullptr
+class ScopedTimer
+{
+public:
+    inline
+    ScopedTimer(PhaseTimers* timers, Phase phase)
+        : m_timers(timers)
+        , m_phase(phase)
+        , m_start(timers ? chrono::ns() : 0)
+    {
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+
+    ScopedTimer&
+    operator=(const ScopedTimer&) = delete;
+
+    inline
+    ~ScopedTimer()
+    {
+        if (m_timers)
+        {
+            m_timers->add(m_phase, chrono::ns() - m_start);
+        }
+    }
+
+private:
+    PhaseTimers* m_timers;
+    Phase m_phase;
+    uint64_t m_start;
+};
+
+}
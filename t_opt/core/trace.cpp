@@ -0,0 +1,496 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include <fmt/core.h>
+
+namespace t_opt
+{
+
+namespace
+{
+
+const char MAGIC[8] = {'T', 'O', 'P', 'T', 'T', 'R', 'C', '\0'};
+
+// Rows count of a chunk, a shorter chunk is written only by flush()
+const uint32_t CHUNK_ROWS = 1 << 12;
+
+inline void
+put_bytes(std::vector<uint8_t>& buffer, const void* data, size_t size)
+{
+    const auto p = static_cast<const uint8_t*>(data);
+    buffer.insert(buffer.end(), p, p + size);
+}
+
+inline void
+put_u32(std::vector<uint8_t>& buffer, uint32_t value)
+{
+    put_bytes(buffer, &value, sizeof(value));
+}
+
+inline void
+put_string(std::vector<uint8_t>& buffer, const String& s)
+{
+    const auto size = std::min<size_t>(s.size(), 255);
+    buffer.push_back(size);
+    put_bytes(buffer, s.data(), size);
+}
+
+inline void
+put_varint(std::vector<uint8_t>& buffer, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        buffer.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    buffer.push_back(uint8_t(value));
+}
+
+inline uint64_t
+zigzag(int64_t value)
+{
+    return (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+}
+
+inline int64_t
+unzigzag(uint64_t value)
+{
+    return int64_t(value >> 1) ^ -int64_t(value & 1);
+}
+
+// Raw stored value of a double column
+inline uint64_t
+double_bits(double value, bool single)
+{
+    if (single)
+    {
+        const float f = value;
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    }
+
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+inline double
+bits_double(uint64_t bits, bool single)
+{
+    if (single)
+    {
+        const uint32_t b = bits;
+        float f;
+        std::memcpy(&f, &b, sizeof(f));
+        return f;
+    }
+
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Bounds checked reading of a chunk or a header
+class Input
+{
+public:
+    Input(const uint8_t* begin, const uint8_t* end)
+        : m_p(begin)
+        , m_end(end)
+    {
+    }
+
+    bool
+    bytes(void* data, size_t size)
+    {
+        if (size_t(m_end - m_p) < size)
+        {
+            return false;
+        }
+
+        std::memcpy(data, m_p, size);
+        m_p += size;
+
+        return true;
+    }
+
+    bool
+    varint(uint64_t& value)
+    {
+        value = 0;
+        for (unsigned shift = 0; shift < 64 && m_p != m_end; shift += 7)
+        {
+            const auto byte = *m_p++;
+            value |= uint64_t(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    const uint8_t* m_p;
+    const uint8_t* m_end;
+};
+
+bool
+read_string(std::FILE* file, String& s)
+{
+    uint8_t size;
+    if (std::fread(&size, 1, 1, file) != 1)
+    {
+        return false;
+    }
+
+    s.resize(size);
+    return size == 0 || std::fread(&s[0], 1, size, file) == size;
+}
+
+// Appended records are decoded with the columns of the file header, names may differ
+bool
+same_columns(const std::vector<TraceColumn>& a, const std::vector<TraceColumn>& b)
+{
+    if (a.size() != b.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        if (a[i].kind != b[i].kind || a[i].single != b[i].single || a[i].text != b[i].text)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}
+
+TraceWriter::TraceWriter(std::FILE* file, bool delta)
+    : m_file(file)
+    , m_flags(delta ? TRACE_DELTA : 0)
+    , m_append(false)
+    , m_rows(0)
+{
+}
+
+TraceWriter::TraceWriter(std::FILE* file, uint32_t flags, const std::vector<TraceColumn>& columns)
+    : m_file(file)
+    , m_flags(flags)
+    , m_append(true)
+    , m_file_columns(columns)
+    , m_rows(0)
+{
+}
+
+void
+TraceWriter::write(const LogRecord& record)
+{
+    if (m_columns.empty())
+    {
+        bool names = true;
+        for (uint32_t i = 0; i < record.count; ++i)
+        {
+            names = names && (record.cells[i].kind == LogCell::Kind::Text);
+        }
+
+        // the first values record defines the types of columns
+        if (names && m_names.empty())
+        {
+            m_names.resize(record.count);
+            for (uint32_t i = 0; i < record.count; ++i)
+            {
+                m_names[i] = String(record.cells[i].text, strnlen(record.cells[i].text, LogCell::TEXT_SIZE));
+            }
+            return;
+        }
+
+        make_columns(record);
+
+        if (m_append == false)
+        {
+            write_header();
+        }
+        else if (same_columns(m_columns, m_file_columns) == false)
+        {
+            printf("Trace columns differ from the appended file, trace is not written\n");
+            m_file = nullptr;
+        }
+    }
+
+    if (m_file == nullptr || record.count != m_columns.size())
+    {
+        // FIXME print warning ?
+        return;
+    }
+
+    for (uint32_t i = 0; i < record.count; ++i)
+    {
+        const auto& cell = record.cells[i];
+        const auto& column = m_columns[i];
+
+        switch (column.kind)
+        {
+            case LogCell::Kind::Text:
+                break;
+
+            case LogCell::Kind::Size:
+                m_values[i].push_back(cell.size);
+                break;
+
+            case LogCell::Kind::Double:
+            {
+                // method columns with preformatted values are parsed back
+                const auto value = cell.kind == LogCell::Kind::Double ? cell.number : std::strtod(cell.text, nullptr);
+                m_values[i].push_back(double_bits(value, column.single));
+                break;
+            }
+        }
+    }
+
+    m_rows += 1;
+    if (m_rows == CHUNK_ROWS)
+    {
+        flush();
+    }
+}
+
+void
+TraceWriter::make_columns(const LogRecord& record)
+{
+    m_columns.resize(record.count);
+    m_values.resize(record.count);
+
+    for (uint32_t i = 0; i < record.count; ++i)
+    {
+        const auto& cell = record.cells[i];
+        auto& column = m_columns[i];
+
+        column.name = i < m_names.size() ? m_names[i] : fmt::format("column_{}", i);
+        column.kind = cell.kind;
+        column.precision = cell.kind == LogCell::Kind::Double ? cell.precision : 0;
+
+        if (cell.kind == LogCell::Kind::Text)
+        {
+            column.text = String(cell.text, strnlen(cell.text, LogCell::TEXT_SIZE));
+
+            char* end;
+            std::strtod(column.text.c_str(), &end);
+            if (end != column.text.c_str() && *end == '\0')
+            {
+                column.kind = LogCell::Kind::Double;
+                column.precision = 6;
+                column.text.clear();
+            }
+        }
+
+        column.single = column.kind == LogCell::Kind::Double && column.precision <= 6;
+    }
+}
+
+void
+TraceWriter::write_header()
+{
+    if (m_file == nullptr)
+    {
+        return;
+    }
+
+    m_buffer.clear();
+    put_bytes(m_buffer, MAGIC, sizeof(MAGIC));
+    put_u32(m_buffer, TRACE_VERSION);
+    put_u32(m_buffer, m_flags);
+    put_u32(m_buffer, m_columns.size());
+
+    for (const auto& column : m_columns)
+    {
+        m_buffer.push_back(uint8_t(column.kind));
+        m_buffer.push_back(column.precision);
+        m_buffer.push_back(column.single);
+        put_string(m_buffer, column.name);
+        put_string(m_buffer, column.text);
+    }
+
+    std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file);
+}
+
+void
+TraceWriter::flush()
+{
+    if (m_rows == 0 || m_file == nullptr)
+    {
+        return;
+    }
+
+    m_buffer.clear();
+
+    for (size_t c = 0; c < m_columns.size(); ++c)
+    {
+        const auto& column = m_columns[c];
+        auto& values = m_values[c];
+
+        if (column.kind == LogCell::Kind::Text)
+        {
+            continue;
+        }
+
+        uint64_t prev = 0;
+        for (auto value : values)
+        {
+            if ((m_flags & TRACE_DELTA) == 0)
+            {
+                put_bytes(m_buffer, &value, column.single ? 4 : 8);
+            }
+            else if (column.kind == LogCell::Kind::Size)
+            {
+                put_varint(m_buffer, zigzag(int64_t(value - prev)));
+            }
+            else
+            {
+                put_varint(m_buffer, value ^ prev);
+            }
+
+            prev = value;
+        }
+
+        values.clear();
+    }
+
+    const uint32_t header[2] = {m_rows, uint32_t(m_buffer.size())};
+    std::fwrite(header, sizeof(header), 1, m_file);
+    std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file);
+
+    m_rows = 0;
+}
+
+TraceReader::TraceReader()
+    : m_file(nullptr)
+    , m_flags(0)
+    , m_error(false)
+{
+}
+
+TraceReader::~TraceReader()
+{
+    if (m_file)
+    {
+        std::fclose(m_file);
+    }
+}
+
+bool
+TraceReader::open(const String& file_name)
+{
+    m_file = std::fopen(file_name.c_str(), "rb");
+    if (m_file == nullptr)
+    {
+        printf("Can't open trace file '%s'\n", file_name.c_str());
+        return false;
+    }
+
+    char magic[sizeof(MAGIC)];
+    uint32_t header[3];
+    if (std::fread(magic, sizeof(magic), 1, m_file) != 1 || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        std::fread(header, sizeof(header), 1, m_file) != 1 || header[0] != TRACE_VERSION)
+    {
+        printf("'%s' is not a trace file or has unsupported version\n", file_name.c_str());
+        return false;
+    }
+
+    m_flags = header[1];
+    m_columns.resize(header[2]);
+
+    for (auto& column : m_columns)
+    {
+        uint8_t info[3];
+        if (std::fread(info, sizeof(info), 1, m_file) != 1 ||
+            read_string(m_file, column.name) == false ||
+            read_string(m_file, column.text) == false)
+        {
+            printf("Trace file '%s' has broken header\n", file_name.c_str());
+            return false;
+        }
+
+        column.kind = LogCell::Kind(info[0]);
+        column.precision = info[1];
+        column.single = info[2] != 0;
+    }
+
+    return true;
+}
+
+bool
+TraceReader::next(std::vector<std::vector<double>>& values, uint32_t& rows)
+{
+    uint32_t header[2];
+    if (std::fread(header, sizeof(header), 1, m_file) != 1)
+    {
+        return false;
+    }
+
+    rows = header[0];
+    m_buffer.resize(header[1]);
+    if (std::fread(m_buffer.data(), 1, m_buffer.size(), m_file) != m_buffer.size())
+    {
+        printf("Trace chunk is truncated\n");
+        m_error = true;
+        return false;
+    }
+
+    Input input(m_buffer.data(), m_buffer.data() + m_buffer.size());
+
+    values.resize(m_columns.size());
+    for (size_t c = 0; c < m_columns.size(); ++c)
+    {
+        const auto& column = m_columns[c];
+        auto& column_values = values[c];
+
+        column_values.clear();
+        if (column.kind == LogCell::Kind::Text)
+        {
+            continue;
+        }
+
+        column_values.resize(rows);
+
+        uint64_t prev = 0;
+        for (uint32_t r = 0; r < rows; ++r)
+        {
+            uint64_t value = 0;
+            bool ok;
+
+            if ((m_flags & TRACE_DELTA) == 0)
+            {
+                ok = input.bytes(&value, column.single ? 4 : 8);
+            }
+            else
+            {
+                ok = input.varint(value);
+                value = column.kind == LogCell::Kind::Size ? prev + unzigzag(value) : prev ^ value;
+            }
+
+            if (ok == false)
+            {
+                printf("Trace chunk is broken\n");
+                m_error = true;
+                return false;
+            }
+
+            prev = value;
+            column_values[r] = column.kind == LogCell::Kind::Size ? double(value) : bits_double(value, column.single);
+        }
+    }
+
+    return true;
+}
+
+}
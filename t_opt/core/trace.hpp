@@ -0,0 +1,118 @@
+#pragma once
+
+#include "log_writer.hpp"
+#include "types.hpp"
+
+namespace t_opt
+{
+
+// Binary columnar trace of a method run, an alternative to the csv log. The file is
+//
+//     header: MAGIC, uint32 version, uint32 flags, uint32 columns count, columns
+//     column: uint8 kind, uint8 precision, uint8 single, string name, string text
+//     chunk:  uint32 rows, uint32 size, streams of all non-text columns (size bytes)
+//
+// where string is uint8 size + chars and all numbers are little endian. Text columns (method
+// name) are constant and stored in the header only. Double columns with csv precision of 6
+// digits or less are stored as float. With TRACE_DELTA flag, size values are stored as zigzag
+// varints of differences with the previous row and double ones as varints of bits xored with
+// the previous row, otherwise values are stored as is. Every chunk starts from zero.
+
+static const uint32_t TRACE_VERSION = 1;
+static const uint32_t TRACE_DELTA = 1 << 0;
+
+struct TraceColumn
+{
+    LogCell::Kind kind;
+    uint8_t precision;
+    bool single;
+
+    String name;
+    String text;
+};
+
+// Encodes log records of LogWriter, the first record is the csv header
+class TraceWriter
+{
+public:
+    // Writes a new trace, the header is written with the first values record
+    TraceWriter(std::FILE* file, bool delta);
+
+    // Appends to a trace with the given flags and columns (see TraceReader), nothing is written
+    // if the records have other columns
+    TraceWriter(std::FILE* file, uint32_t flags, const std::vector<TraceColumn>& columns);
+
+    void
+    write(const LogRecord& record);
+
+    // Writes buffered rows as a chunk
+    void
+    flush();
+
+private:
+    void
+    make_columns(const LogRecord& record);
+
+    void
+    write_header();
+
+    std::FILE* m_file;
+    uint32_t m_flags;
+    bool m_append;
+
+    // columns of the appended file
+    std::vector<TraceColumn> m_file_columns;
+
+    std::vector<String> m_names;
+    std::vector<TraceColumn> m_columns;
+
+    // m_values[c] are raw values (integers or double/float bits) of the buffered rows
+    std::vector<std::vector<uint64_t>> m_values;
+    uint32_t m_rows;
+
+    std::vector<uint8_t> m_buffer;
+};
+
+class TraceReader
+{
+public:
+    TraceReader();
+
+    ~TraceReader();
+
+    bool
+    open(const String& file_name);
+
+    inline uint32_t
+    flags() const
+    {
+        return m_flags;
+    }
+
+    inline const std::vector<TraceColumn>&
+    columns() const
+    {
+        return m_columns;
+    }
+
+    // Decodes the next chunk, values[c][r] is a value of column c at row r (empty for text
+    // columns), returns false at the end of file or on error
+    bool
+    next(std::vector<std::vector<double>>& values, uint32_t& rows);
+
+    inline bool
+    error() const
+    {
+        return m_error;
+    }
+
+private:
+    std::FILE* m_file;
+    uint32_t m_flags;
+    bool m_error;
+
+    std::vector<TraceColumn> m_columns;
+    std::vector<uint8_t> m_buffer;
+};
+
+}
@@ -22,30 +22,46 @@ to_string(ProblemProperty p)
             static const String s("lipschitz constant");
             return s;
         }
+
+        case ProblemProperty::LineEvaluation:
+        {
+            static const String s("line evaluation");
+            return s;
+        }
+
+        case ProblemProperty::DualPoint:
+        {
+            static const String s("dual point");
+            return s;
+        }
     };
 
     // -Wreturn-type warning fix
     return {};
 }
 
-Point::Point()
+template <typename T>
+BasicPoint<T>::BasicPoint()
 {
     reset();
 }
 
-Point::Point(const Problem& problem)
+template <typename T>
+BasicPoint<T>::BasicPoint(const BasicProblem<T>& problem)
 {
     resize(problem);
 }
 
+template <typename T>
 void
-Point::reset()
+BasicPoint<T>::reset()
 {
     f = g_nrm2 = g_nrm2_2 = limits<double>::quiet_NaN();
 }
 
+template <typename T>
 void
-Point::resize(const Problem& problem)
+BasicPoint<T>::resize(const BasicProblem<T>& problem)
 {
     x.resize(problem.size());
 
@@ -64,8 +80,9 @@ Point::resize(const Problem& problem)
     reset();
 }
 
+template <typename T>
 void
-Point::swap(Point& other)
+BasicPoint<T>::swap(BasicPoint& other)
 {
     x.swap(other.x);
     g.swap(other.g);
@@ -77,4 +94,7 @@ Point::swap(Point& other)
     std::swap(g_nrm_inf, other.g_nrm_inf);
 }
 
+template class BasicPoint<double>;
+template class BasicPoint<float>;
+
 }
@@ -29,32 +29,41 @@ enum class ProblemProperty : uint8_t
 {
     Gradient = 1 << 0,
     LipschitzConstant = 1 << 1,
+    // line_setup() / line_f() are implemented
+    LineEvaluation = 1 << 2,
+    // df() and fdf() also recover the dual point, see last_dual_x()
+    DualPoint = 1 << 3,
 };
 using ProblemPropertyFlags = flags::flags<ProblemProperty>;
 
 String
 to_string(ProblemProperty p);
 
-class Problem;
+template <typename T>
+class BasicProblem;
 
-class Point
+// Iterate of a problem with scalar type T, function value and gradient norms are always double
+template <typename T>
+class BasicPoint
 {
 public:
-    Point();
+    using Scalar = T;
 
-    Point(const Point& other) = default;
+    BasicPoint();
+
+    BasicPoint(const BasicPoint& other) = default;
 
     explicit
-    Point(const Problem& problem);
+    BasicPoint(const BasicProblem<T>& problem);
 
     void
-    resize(const Problem& problem);
+    resize(const BasicProblem<T>& problem);
 
     void
-    swap(Point& other);
+    swap(BasicPoint& other);
 
-    DVector x;
-    DVector g;
+    Vector<T> x;
+    Vector<T> g;
 
     double f;
     double g_nrm_1;
@@ -67,6 +76,14 @@ private:
     reset();
 };
 
+using Problem = BasicProblem<double>;
+using Point = BasicPoint<double>;
+
+// single precision mode, see BasicProblem
+using FVector = Vector<float>;
+using FProblem = BasicProblem<float>;
+using FPoint = BasicPoint<float>;
+
 }
 
 ALLOW_FLAGS_FOR_ENUM(t_opt::ProblemProperty)
@@ -1,6 +1,7 @@
 #include "h_simple.hpp"
 #include "core/blas.hpp"
 #include "core/problem.hpp"
+#include "core/timers.hpp"
 
 namespace t_opt
 {
@@ -8,53 +9,76 @@ namespace t_opt
 namespace line_search
 {
 
-HSimple::HSimple()
-    : HSimple(0.5, 1.5)
+template <typename T>
+BasicHSimple<T>::BasicHSimple()
+    : BasicHSimple(0.5, 1.5)
 {
 }
 
-HSimple::HSimple(double step_minus_k, double step_plus_k)
+template <typename T>
+BasicHSimple<T>::BasicHSimple(double step_minus_k, double step_plus_k)
     : step_minus_k(step_minus_k)
     , step_plus_k(step_plus_k)
     , step_min(limits<double>::epsilon())
     , fixed_step(limits<double>::quiet_NaN())
+    , line(false)
 {
 }
 
-HSimple::HSimple(double fixed_step)
+template <typename T>
+BasicHSimple<T>::BasicHSimple(double fixed_step)
     : step_minus_k(limits<double>::quiet_NaN())
     , step_plus_k(limits<double>::quiet_NaN())
     , step_min(limits<double>::epsilon())
     , fixed_step(fixed_step)
+    , line(false)
 {
 }
 
+template <typename T>
 void
-HSimple::setup(Problem& problem)
+BasicHSimple<T>::setup(Problem& problem)
 {
     probe_point.resize(problem);
 }
 
+template <typename T>
 LineSearchProbe
-HSimple::probe(Problem& problem, const Point& point, const DVector& dir, double step)
+BasicHSimple<T>::probe(Problem& problem, const Point& point, const Vector<T>& dir, double step)
 {
+    if (line)
+    {
+        return { step, problem.line_f(step) };
+    }
+
     blas::axpyz(step, dir, point.x, probe_point.x);
     problem.f(probe_point);
 //     printf("step = %g f = %g\n", step, probe_point.f);
     return { step, probe_point.f };
 }
 
+template <typename T>
 LineSearchProbe
-HSimple::search(Problem& problem, const Point& point, const DVector& dir, bool dir_is_gradient, double start_step)
+BasicHSimple<T>::search(Problem& problem, const Point& point, const Vector<T>& dir, bool dir_is_gradient, double start_step)
 {
+    ScopedTimer timer(problem.timers(), Phase::LineSearch);
+
+    // a single probe of the fixed step is not worth line setup
+    line = false;
     if (std::isnan(fixed_step) == false)
     {
-        fixed_step = fix_step(fixed_step, dir_is_gradient);
+        fixed_step = this->fix_step(fixed_step, dir_is_gradient);
         return probe(problem, point, dir, fixed_step);
     }
 
+    line = problem.has(ProblemProperty::LineEvaluation);
+    if (line)
+    {
+        problem.line_setup(point.x, dir);
+    }
+
 //     printf("\n");
-    start_step = fix_step(start_step, dir_is_gradient);
+    start_step = this->fix_step(start_step, dir_is_gradient);
     auto probe_0 = probe(problem, point, dir, start_step);
 
     if (probe_0.f < point.f)
@@ -84,6 +108,9 @@ HSimple::search(Problem& problem, const Point& point, const DVector& dir, bool d
     return probe_0;
 }
 
+template struct BasicHSimple<double>;
+template struct BasicHSimple<float>;
+
 }
 
 }
@@ -8,17 +8,21 @@ namespace t_opt
 namespace line_search
 {
 
-struct HSimple : public LineSearchMethod
+template <typename T>
+struct BasicHSimple : public BasicLineSearchMethod<T>
 {
-    HSimple();
-    HSimple(double step_minus_k, double step_plus_k);
-    HSimple(double fixed_step);
+    using Point = BasicPoint<T>;
+    using Problem = BasicProblem<T>;
+
+    BasicHSimple();
+    BasicHSimple(double step_minus_k, double step_plus_k);
+    BasicHSimple(double fixed_step);
 
     void
     setup(Problem& problem) override;
 
     LineSearchProbe
-    search(Problem& problem, const Point& point, const DVector& dir, bool dir_is_gradient, double start_step) override;
+    search(Problem& problem, const Point& point, const Vector<T>& dir, bool dir_is_gradient, double start_step) override;
 
     double step_minus_k;
     double step_plus_k;
@@ -26,12 +30,17 @@ struct HSimple : public LineSearchMethod
 
 private:
     LineSearchProbe
-    probe(Problem& problem, const Point& point, const DVector& dir, double step);
+    probe(Problem& problem, const Point& point, const Vector<T>& dir, double step);
 
     Point probe_point;
     double fixed_step;
+
+    // probes of the current search use Problem::line_f()
+    bool line;
 };
 
+using HSimple = BasicHSimple<double>;
+
 }
 
 }
@@ -2,6 +2,7 @@
 
 #include "core/blas.hpp"
 #include "core/problem.hpp"
+#include "core/timers.hpp"
 
 namespace t_opt
 {
@@ -13,17 +14,21 @@ namespace line_search
 // 1) pass single bool use_gradient parameter and set probes to 2 when true and 3 when false
 // 2) add new h_parabolic searcher which combines 2 approaches
 
-Parabolic::Parabolic(uint8_t probes, bool use_gradient)
+template <typename T>
+BasicParabolic<T>::BasicParabolic(uint8_t probes, bool use_gradient)
     : probes(probes)
     , max_probes(20) // FIXME
     , use_gradient(use_gradient)
+    , line(false)
 {
 }
 
+template <typename T>
 void
-Parabolic::setup(Problem& problem)
+BasicParabolic<T>::setup(Problem& problem)
 {
     probe_point.resize(problem);
+    pair_point.resize(problem);
 
 //         if self.use_gradient {
 //             if !problem.has_gradient() {
@@ -47,17 +52,46 @@ Parabolic::setup(Problem& problem)
 //         }
 }
 
+template <typename T>
 void
-Parabolic::probe(Problem& problem, const Point& point, const DVector& dir, uint8_t i)
+BasicParabolic<T>::probe(Problem& problem, const Point& point, const Vector<T>& dir, uint8_t i)
 {
+    if (line)
+    {
+        p[i].f = problem.line_f(p[i].step);
+        return;
+    }
+
     blas::axpyz(p[i].step, dir, point.x, probe_point.x);
     problem.f(probe_point);
     p[i].f = probe_point.f;
 //     printf("step = %g f = %g\n", p[i].step, p[i].f);
 }
 
+template <typename T>
+void
+BasicParabolic<T>::probe_pair(Problem& problem, const Point& point, const Vector<T>& dir, uint8_t i, uint8_t j)
+{
+    if (line)
+    {
+        probe(problem, point, dir, i);
+        probe(problem, point, dir, j);
+        return;
+    }
+
+    blas::axpyz(p[i].step, dir, point.x, probe_point.x);
+    blas::axpyz(p[j].step, dir, point.x, pair_point.x);
+
+    Point* points[] = {&probe_point, &pair_point};
+    problem.f_batch(points, 2);
+
+    p[i].f = probe_point.f;
+    p[j].f = pair_point.f;
+}
+
+template <typename T>
 void
-Parabolic::sort_probes(uint8_t count)
+BasicParabolic<T>::sort_probes(uint8_t count)
 {
     // Simple bubble sort
 
@@ -90,12 +124,21 @@ solve_3(const LineSearchProbe* p)
     return -0.5 * det_b / det_a;
 }
 
+template <typename T>
 LineSearchProbe
-Parabolic::search(Problem& problem, const Point& point, const DVector& dir, bool dir_is_gradient, double start_step)
+BasicParabolic<T>::search(Problem& problem, const Point& point, const Vector<T>& dir, bool dir_is_gradient, double start_step)
 {
+    ScopedTimer timer(problem.timers(), Phase::LineSearch);
+
 //     printf("\n");
     // FIXME check start_step with isfinite()
-    start_step = fix_step(start_step, dir_is_gradient);
+    start_step = this->fix_step(start_step, dir_is_gradient);
+
+    line = problem.has(ProblemProperty::LineEvaluation);
+    if (line)
+    {
+        problem.line_setup(point.x, dir);
+    }
 
     p[0].step = 0.0;
     p[0].f = point.f;
@@ -114,7 +157,16 @@ Parabolic::search(Problem& problem, const Point& point, const DVector& dir, bool
                 p[1].step = -0.5 * start_step;
             }
 
-            probe(problem, point, dir, 1);
+            if (use_gradient == false && probes >= 2)
+            {
+                // the second probe doesn't depend on the first one
+                p[2].step = -p[1].step;
+                probe_pair(problem, point, dir, 1, 2);
+            }
+            else
+            {
+                probe(problem, point, dir, 1);
+            }
         }
         else if (i == 2)
         {
@@ -138,11 +190,7 @@ Parabolic::search(Problem& problem, const Point& point, const DVector& dir, bool
                     p[2].f = point.f;
                 }
             }
-            else
-            {
-                p[2].step = -p[1].step;
-                probe(problem, point, dir, 2);
-            };
+            // else p[2] is probed together with p[1]
         }
         else
         {
@@ -189,6 +237,9 @@ Parabolic::search(Problem& problem, const Point& point, const DVector& dir, bool
     return {0.0, point.f};
 }
 
+template struct BasicParabolic<double>;
+template struct BasicParabolic<float>;
+
 }
 
 }
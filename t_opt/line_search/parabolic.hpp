@@ -8,19 +8,27 @@ namespace t_opt
 namespace line_search
 {
 
-struct Parabolic : public LineSearchMethod
+template <typename T>
+struct BasicParabolic : public BasicLineSearchMethod<T>
 {
-    Parabolic(uint8_t probes, bool use_gradient);
+    using Point = BasicPoint<T>;
+    using Problem = BasicProblem<T>;
+
+    BasicParabolic(uint8_t probes, bool use_gradient);
 
     void
     setup(Problem& problem) override;
 
     LineSearchProbe
-    search(Problem& problem, const Point& point, const DVector& dir, bool dir_is_gradient, double start_step) override;
+    search(Problem& problem, const Point& point, const Vector<T>& dir, bool dir_is_gradient, double start_step) override;
 
 private:
     void
-    probe(Problem& problem, const Point& point, const DVector& dir, uint8_t i);
+    probe(Problem& problem, const Point& point, const Vector<T>& dir, uint8_t i);
+
+    // Probes p[i] and p[j] with one Problem::f_batch() call
+    void
+    probe_pair(Problem& problem, const Point& point, const Vector<T>& dir, uint8_t i, uint8_t j);
 
     void
     sort_probes(uint8_t count);
@@ -30,9 +38,15 @@ private:
     bool use_gradient;
 
     Point probe_point;
+    Point pair_point;
     LineSearchProbe p[4]; // FIXME rename
+
+    // probes of the current search use Problem::line_f()
+    bool line;
 };
 
+using Parabolic = BasicParabolic<double>;
+
 }
 
 }
@@ -11,16 +11,18 @@ namespace t_opt
 namespace local
 {
 
-AFGM::AFGM(LineSearchMethod& ls)
-    : Method("AFGM", ProblemProperty::Gradient)
+template <typename T>
+BasicAFGM<T>::BasicAFGM(LineSearchMethod& ls)
+    : BasicMethod<T>("AFGM", ProblemProperty::Gradient)
     , ls(ls)
     , ls_start_step(1.0)
     , ls_step(1.0)
 {
 }
 
+template <typename T>
 void
-AFGM::before(Problem& problem, Point& point)
+BasicAFGM<T>::before(Problem& problem, Point& point)
 {
     ls.setup(problem);
 
@@ -31,7 +33,7 @@ AFGM::before(Problem& problem, Point& point)
 
     ls_step = ls_start_step;
 
-    alpha = alpha_sum = 0.0;
+    alpha = 0.0;
 
     // FIXME add operator=() ?
     x = Point(point);
@@ -41,17 +43,11 @@ AFGM::before(Problem& problem, Point& point)
 //     z.x.setZero();
 
     zy.resize(problem.size());
-
-    // FIXME add method to problem class? or add dual size method ?
-    dual_p.x.resize(problem.dual_size());
-    dual_p_sum.x.resize(problem.dual_size());
-    dual_p_sum.x.setZero();
-
-    pd_delta = 0.0;
 }
 
+template <typename T>
 bool
-AFGM::iteration(Problem& problem, Point& y, size_t iter)
+BasicAFGM<T>::iteration(Problem& problem, Point& y, size_t iter)
 {
     if (iter > 0)
     {
@@ -74,18 +70,17 @@ AFGM::iteration(Problem& problem, Point& y, size_t iter)
         if (tau == probe.step)
         {
             x.f = probe.f;
+            problem.df(x);
         }
         else
         {
             // FIXME add check for tau == 0.0
-            problem.f(x);
-
+            problem.fdf(x);
         }
 //         if (tau == probe.step)
 //         {
 //             printf("xf = %e pf = %e dd = %e\n", x.f, probe.f, x.f - probe.f);
 //         }
-        problem.df(x);
     }
 
     const auto probe = ls.search(problem, x, x.g, true, ls_step);
@@ -111,70 +106,25 @@ AFGM::iteration(Problem& problem, Point& y, size_t iter)
 
     blas::axpy(-alpha, x.g, z.x);
 
-    if (false)
-    {
-        problem.dual_x(y, dual_p);
-
-        alpha_sum += alpha;
-        dual_p_sum.x += alpha * dual_p.x;
-        dual_p.x = (1.0 / alpha_sum) * dual_p_sum.x;
-
-        problem.dual_f(dual_p);
-        pd_delta = y.f + dual_p.f;
-    }
+    // df(y) is the last gradient evaluation
+    this->average_dual(problem, y, alpha);
 
     return true;
 }
 
+template <typename T>
 void
-AFGM::log(Logger& logger, LoggerMode mode) const
+BasicAFGM<T>::log(Logger& logger, LoggerMode mode) const
 {
-    return;
-    // FIXME add method for prime-dual f into logger ?
-    char line[1024];
-
-    static const char* F_NAME = "PD_delta";
-
-    static const int F_GN_PRECISION = 16;
-    static const int F_GN_WIDTH = F_GN_PRECISION + 7;
-
-    logger.put_delimiter();
-
-//     auto pd_delta = std::fabs(this->pd_delta); // FIXME
-
-    switch (mode)
+    if (this->m_gap_used)
     {
-        case LoggerMode::Header :
-            switch (logger.device())
-            {
-                case LoggerDevice::Stdout :
-                    sprintf(line, " %-*s", F_GN_WIDTH - 1, F_NAME);
-                    logger.put_value(line);
-                    break;
-
-                case LoggerDevice::CsvFile :
-                    logger.put_value(F_NAME);
-                    break;
-            }
-            break;
-
-        case LoggerMode::Value :
-            switch (logger.device())
-            {
-                case LoggerDevice::Stdout :
-                    sprintf(line, "% -*.*e", F_GN_WIDTH, F_GN_PRECISION, pd_delta);
-                    logger.put_value(line);
-                    break;
-
-                case LoggerDevice::CsvFile :
-                    sprintf(line, "%.*e", 6, pd_delta);
-                    logger.put_value(line);
-                    break;
-            }
-            break;
-    };
+        logger.put_gap(mode, this->m_gap, this->m_gap_g_nrm2);
+    }
 }
 
+template class BasicAFGM<double>;
+template class BasicAFGM<float>;
+
 }
 
 }
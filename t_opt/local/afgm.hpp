@@ -8,11 +8,16 @@ namespace t_opt
 namespace local
 {
 
-class AFGM : public Method
+template <typename T>
+class BasicAFGM : public BasicMethod<T>
 {
 public:
+    using Point = BasicPoint<T>;
+    using Problem = BasicProblem<T>;
+    using LineSearchMethod = BasicLineSearchMethod<T>;
+
     explicit
-    AFGM(LineSearchMethod& ls);
+    BasicAFGM(LineSearchMethod& ls);
 
 protected:
     void
@@ -30,17 +35,14 @@ private:
     double ls_step = 1.0;
 
     double alpha;
-    double alpha_sum;
 
     Point x;
     Point z;
-    DVector zy;
-
-    Point dual_p;
-    Point dual_p_sum;
-    double pd_delta;
+    Vector<T> zy;
 };
 
+using AFGM = BasicAFGM<double>;
+
 }
 
 }
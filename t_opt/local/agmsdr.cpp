@@ -10,8 +10,9 @@ namespace t_opt
 namespace local
 {
 
-AGMsDR::AGMsDR(LineSearchMethod& ls, double epsilon)
-    : Method("AGMsDR", ProblemProperty::Gradient)
+template <typename T>
+BasicAGMsDR<T>::BasicAGMsDR(LineSearchMethod& ls, double epsilon)
+    : BasicMethod<T>("AGMsDR", ProblemProperty::Gradient)
     , ls(ls)
     , ls_start_step(1.0)
     , ls_step(1.0)
@@ -20,8 +21,9 @@ AGMsDR::AGMsDR(LineSearchMethod& ls, double epsilon)
 {
 }
 
+template <typename T>
 void
-AGMsDR::before(Problem& problem, Point& point)
+BasicAGMsDR<T>::before(Problem& problem, Point& point)
 {
     ls.setup(problem);
 
@@ -41,8 +43,9 @@ AGMsDR::before(Problem& problem, Point& point)
     vx.resize(problem.size());
 }
 
+template <typename T>
 bool
-AGMsDR::iteration(Problem& problem, Point& point, size_t iter)
+BasicAGMsDR<T>::iteration(Problem& problem, Point& point, size_t iter)
 {
     // At first iteration (== 0) y.x will be equal to point.x, so we set it to
     // start point inside the before() method.
@@ -70,12 +73,12 @@ AGMsDR::iteration(Problem& problem, Point& point, size_t iter)
         if (beta == probe.step)
         {
             y.f = probe.f;
+            problem.df(y);
         }
         else
         {
-            problem.f(y);
+            problem.fdf(y);
         }
-        problem.df(y);
     }
 
     const auto probe = ls.search(problem, y, y.g, true, ls_step);
@@ -120,6 +123,9 @@ AGMsDR::iteration(Problem& problem, Point& point, size_t iter)
     return true;
 }
 
+template class BasicAGMsDR<double>;
+template class BasicAGMsDR<float>;
+
 }
 
 }
@@ -8,11 +8,16 @@ namespace t_opt
 namespace local
 {
 
-class AGMsDR : public Method
+template <typename T>
+class BasicAGMsDR : public BasicMethod<T>
 {
 public:
+    using Point = BasicPoint<T>;
+    using Problem = BasicProblem<T>;
+    using LineSearchMethod = BasicLineSearchMethod<T>;
+
     explicit
-    AGMsDR(LineSearchMethod& ls, double epsilon);
+    BasicAGMsDR(LineSearchMethod& ls, double epsilon);
 
 protected:
     void
@@ -30,10 +35,12 @@ private:
 
     double A;
     Point y;
-    DVector v;
-    DVector vx;
+    Vector<T> v;
+    Vector<T> vx;
 };
 
+using AGMsDR = BasicAGMsDR<double>;
+
 }
 
 }
@@ -160,8 +160,9 @@ cg_dir_by_s(CgVariant variant)
     return false;
 }
 
-CG::CG(CgVariant variant, LineSearchMethod& ls)
-    : Method(fmt::format("CG_{}", to_string(variant)), ProblemProperty::Gradient)
+template <typename T>
+BasicCG<T>::BasicCG(CgVariant variant, LineSearchMethod& ls)
+    : BasicMethod<T>(fmt::format("CG_{}", to_string(variant)), ProblemProperty::Gradient)
     , variant(variant)
     , ls(ls)
     , ls_start_step(1.0) // FIXME
@@ -172,8 +173,9 @@ CG::CG(CgVariant variant, LineSearchMethod& ls)
 //     dir_by_s = cg_dir_by_s(variant);
 }
 
+template <typename T>
 void
-CG::before(Problem& problem, Point& point)
+BasicCG<T>::before(Problem& problem, Point& point)
 {
 //     ls_start_step = 1.0 / point.g_nrm2;
 
@@ -206,14 +208,16 @@ CG::before(Problem& problem, Point& point)
     }
 }
 
+template <typename T>
 void
-CG::log(Logger& logger, LoggerMode mode) const
+BasicCG<T>::log(Logger& logger, LoggerMode mode) const
 {
     logger.put_ls_step(mode, ls_step);
 }
 
+template <typename T>
 void
-CG::calc_dir(const DVector& g)
+BasicCG<T>::calc_dir(const Vector<T>& g)
 {
     // dir = -g
     blas::scal_copy(-1.0, g, dir);
@@ -268,8 +272,9 @@ CG::calc_dir(const DVector& g)
     }
 }
 
+template <typename T>
 void
-CG::before_step(const Point& point)
+BasicCG<T>::before_step(const Point& point)
 {
     // dir_prev = dir
     blas::copy(dir, dir_prev);
@@ -297,8 +302,9 @@ CG::before_step(const Point& point)
     }
 }
 
+template <typename T>
 void
-CG::after_step(const Point& point)
+BasicCG<T>::after_step(const Point& point)
 {
     g_nrm2 = point.g_nrm2;
 
@@ -317,8 +323,9 @@ CG::after_step(const Point& point)
     }
 }
 
+template <typename T>
 bool
-CG::iteration(Problem& problem, Point& point, size_t iter)
+BasicCG<T>::iteration(Problem& problem, Point& point, size_t iter)
 {
     dir_reset = ((iter % 100) == 0); // FIXME add reset parameter
 
@@ -371,6 +378,9 @@ CG::iteration(Problem& problem, Point& point, size_t iter)
     return true;
 }
 
+template class BasicCG<double>;
+template class BasicCG<float>;
+
 }
 
 }
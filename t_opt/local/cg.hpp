@@ -52,10 +52,15 @@ enum class CgVariant : uint8_t
 String
 to_string(CgVariant variant);
 
-class CG : public Method
+template <typename T>
+class BasicCG : public BasicMethod<T>
 {
 public:
-    CG(CgVariant variant, LineSearchMethod& ls);
+    using Point = BasicPoint<T>;
+    using Problem = BasicProblem<T>;
+    using LineSearchMethod = BasicLineSearchMethod<T>;
+
+    BasicCG(CgVariant variant, LineSearchMethod& ls);
 
 protected:
     void
@@ -69,7 +74,7 @@ protected:
 
 private:
     void
-    calc_dir(const DVector& g);
+    calc_dir(const Vector<T>& g);
 
     void
     before_step(const Point& point);
@@ -86,14 +91,14 @@ private:
     double g_nrm2;
     double g_nrm2_prev;
 
-    DVector dir;
-    DVector dir_normalized;
-    DVector dir_prev;
+    Vector<T> dir;
+    Vector<T> dir_normalized;
+    Vector<T> dir_prev;
     bool dir_reset;
 
-    DVector y;
-    DVector s;
-    DVector g_prev;
+    Vector<T> y;
+    Vector<T> s;
+    Vector<T> g_prev;
 
 //     bool use_y;
 //     bool use_s;
@@ -101,6 +106,8 @@ private:
 //     bool dir_by_s;
 };
 
+using CG = BasicCG<double>;
+
 }
 
 }
@@ -8,10 +8,14 @@ namespace t_opt
 namespace local
 {
 
-class FGM : public Method
+template <typename T>
+class BasicFGM : public BasicMethod<T>
 {
 public:
-    FGM();
+    using Point = BasicPoint<T>;
+    using Problem = BasicProblem<T>;
+
+    BasicFGM();
 
 protected:
     void
@@ -24,16 +28,13 @@ protected:
     iteration(Problem& problem, Point& point, size_t iter) override;
 
 private:
-    DVector x;
-    DVector y;
+    Vector<T> x;
+    Vector<T> y;
     double step;
-
-    Point dual_p;
-    Point dual_p_sum;
-    double pd_delta;
-    double alpha_sum;
 };
 
+using FGM = BasicFGM<double>;
+
 }
 
 }
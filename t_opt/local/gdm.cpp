@@ -11,14 +11,16 @@ namespace t_opt
 namespace local
 {
 
-GDM::GDM(LineSearchMethod& ls)
-    : Method("GDM", ProblemProperty::Gradient)
+template <typename T>
+BasicGDM<T>::BasicGDM(LineSearchMethod& ls)
+    : BasicMethod<T>("GDM", ProblemProperty::Gradient)
     , ls(ls)
 {
 }
 
+template <typename T>
 void
-GDM::before(Problem & problem, Point & point)
+BasicGDM<T>::before(Problem & problem, Point & point)
 {
     ls.setup(problem);
 
@@ -27,8 +29,9 @@ GDM::before(Problem & problem, Point & point)
 //     ls_step = ls_start_step = -1.0 / point.g_nrm2_2; // too small start step ?
 }
 
+template <typename T>
 bool
-GDM::iteration(Problem& problem, Point& point, size_t /*iter*/)
+BasicGDM<T>::iteration(Problem& problem, Point& point, size_t /*iter*/)
 {
     auto probe = ls.search(problem, point, point.g, true, ls_step);
     if (probe.step == 0.0)
@@ -45,12 +48,16 @@ GDM::iteration(Problem& problem, Point& point, size_t /*iter*/)
     return true;
 }
 
+template <typename T>
 void
-GDM::log(Logger& logger, LoggerMode mode) const
+BasicGDM<T>::log(Logger& logger, LoggerMode mode) const
 {
     logger.put_ls_step(mode, -ls_step);
 }
 
+template class BasicGDM<double>;
+template class BasicGDM<float>;
+
 }
 
 }
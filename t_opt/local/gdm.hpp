@@ -8,11 +8,16 @@ namespace t_opt
 namespace local
 {
 
-class GDM : public Method
+template <typename T>
+class BasicGDM : public BasicMethod<T>
 {
 public:
+    using Point = BasicPoint<T>;
+    using Problem = BasicProblem<T>;
+    using LineSearchMethod = BasicLineSearchMethod<T>;
+
     explicit
-    GDM(LineSearchMethod& ls);
+    BasicGDM(LineSearchMethod& ls);
 
 protected:
     void
@@ -30,6 +35,8 @@ private:
     double ls_step = 1.0;
 };
 
+using GDM = BasicGDM<double>;
+
 }
 
 }
@@ -13,8 +13,9 @@ namespace t_opt
 namespace local
 {
 
-LBFGS::LBFGS(uint32_t m, LineSearchMethod& ls)
-    : Method(fmt::format("LBFGS_{}", m), ProblemProperty::Gradient)
+template <typename T>
+BasicLBFGS<T>::BasicLBFGS(uint32_t m, LineSearchMethod& ls)
+    : BasicMethod<T>(fmt::format("LBFGS_{}", m), ProblemProperty::Gradient)
     , m(m)
     , ls(ls)
 {
@@ -25,8 +26,9 @@ LBFGS::LBFGS(uint32_t m, LineSearchMethod& ls)
     l_alpha.resize(m);
 }
 
+template <typename T>
 void
-LBFGS::before(Problem & problem, Point & point)
+BasicLBFGS<T>::before(Problem & problem, Point & point)
 {
     ls.setup(problem);
     ls_step = ls_start_step;
@@ -52,14 +54,16 @@ LBFGS::before(Problem & problem, Point & point)
     blas::scal_copy(-1.0 / point.g_nrm2, point.g, dir);
 }
 
+template <typename T>
 void
-LBFGS::log(Logger& logger, LoggerMode mode) const
+BasicLBFGS<T>::log(Logger& logger, LoggerMode mode) const
 {
     logger.put_ls_step(mode, ls_step);
 }
 
+template <typename T>
 bool
-LBFGS::iteration(Problem& problem, Point& point, size_t iter)
+BasicLBFGS<T>::iteration(Problem& problem, Point& point, size_t iter)
 {
     auto bound = std::min(m, (uint32_t)iter + 1); // +1 since iter == 0 at start
 
@@ -129,6 +133,9 @@ LBFGS::iteration(Problem& problem, Point& point, size_t iter)
     return true;
 }
 
+template class BasicLBFGS<double>;
+template class BasicLBFGS<float>;
+
 }
 
 }
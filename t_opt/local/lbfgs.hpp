@@ -8,11 +8,16 @@ namespace t_opt
 namespace local
 {
 
-class LBFGS : public Method
+template <typename T>
+class BasicLBFGS : public BasicMethod<T>
 {
 public:
+    using Point = BasicPoint<T>;
+    using Problem = BasicProblem<T>;
+    using LineSearchMethod = BasicLineSearchMethod<T>;
+
     explicit
-    LBFGS(uint32_t m, LineSearchMethod& ls);
+    BasicLBFGS(uint32_t m, LineSearchMethod& ls);
 
 protected:
     void
@@ -31,19 +36,21 @@ private:
     double ls_step;
     double ls_start_step = 1.0; // FIXME make public ?
 
-    std::vector<DVector> l_s;
-    std::vector<DVector> l_y;
+    std::vector<Vector<T>> l_s;
+    std::vector<Vector<T>> l_y;
 
     DVector l_ys;
     DVector l_alpha;
 
-    DVector x_p;
-    DVector g_p;
-    DVector dir;
+    Vector<T> x_p;
+    Vector<T> g_p;
+    Vector<T> dir;
 
     uint32_t l_end;
 };
 
+using LBFGS = BasicLBFGS<double>;
+
 }
 
 }
@@ -8,10 +8,14 @@ namespace t_opt
 namespace local
 {
 
-class UFGM : public Method
+template <typename T>
+class BasicUFGM : public BasicMethod<T>
 {
 public:
-    UFGM(double epsilon);
+    using Point = BasicPoint<T>;
+    using Problem = BasicProblem<T>;
+
+    BasicUFGM(double epsilon);
 
 protected:
     void
@@ -26,25 +30,21 @@ protected:
     double epsilon;
 
 private:
-    DVector v_k;
-    DVector dyx;
+    Vector<T> v_k;
+    Vector<T> dyx;
 
     Point x_kp1;
     Point y_kp1;
-    DVector z_kp1;
+    Vector<T> z_kp1;
 
     double alpha_k;
     double alpha_kp1;
     double l_k;
     double l_kp1;
-
-
-    Point dual_p;
-    Point dual_p_sum;
-    double pd_delta;
-    double alpha_sum;
 };
 
+using UFGM = BasicUFGM<double>;
+
 }
 
 }
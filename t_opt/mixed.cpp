@@ -0,0 +1,85 @@
+#include "mixed.hpp"
+
+#include "core/blas.hpp"
+#include "core/problem.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace t_opt
+{
+
+// Norm of the float gradient error at point x
+static double
+gradient_noise(FProblem& f_problem, Problem& problem, const DVector& x)
+{
+    FPoint f_point(f_problem);
+    f_point.x = x.cast<float>();
+    f_problem.df(f_point);
+
+    // compare at the rounded point, so only the error of float evaluation is measured
+    Point point(problem);
+    point.x = f_point.x.cast<double>();
+    problem.df(point);
+
+    return (point.g - f_point.g.cast<double>()).norm();
+}
+
+ExitReason
+optimize_mixed(
+    FMethod& f_method, FProblem& f_problem,
+    Method& method, Problem& problem,
+    Point& point, const MethodSettings& settings, State& state,
+    const MixedSettings& mixed)
+{
+    const auto noise = gradient_noise(f_problem, problem, point.x);
+
+    auto f_settings = settings;
+    f_settings.g_nrm2_min = std::max(settings.g_nrm2_min, mixed.noise_k * noise);
+    f_settings.progress_min = std::max(settings.progress_min, mixed.progress_min);
+    f_settings.progress_window = mixed.progress_window;
+
+    if (settings.print)
+    {
+        printf("Single precision phase, gradient noise = %e\n", noise);
+    }
+
+    const auto iter_0 = settings.resume ? state.iter_total : 0;
+    const auto t_0 = settings.resume ? state.t_total : 0.0;
+
+    FPoint f_point(f_problem);
+    f_point.x = point.x.cast<float>();
+    const auto f_reason = f_method.optimize(f_problem, f_point, f_settings, state);
+
+    point.x = f_point.x.cast<double>();
+
+    // limits are shared by both phases
+    const auto iter = state.iter_total - iter_0;
+    const auto t = state.t_total - t_0;
+    if (iter >= settings.iter_max || t >= settings.time_max)
+    {
+        // the point is returned as a double one, with its own f, g and norms
+        problem.fdf(point);
+        state.f_count += 1;
+        state.g_count += 1;
+
+        blas::norms(point.g, point.g_nrm_1, point.g_nrm2_2, point.g_nrm_inf);
+        point.g_nrm2 = std::sqrt(point.g_nrm2_2);
+
+        return f_reason;
+    }
+
+    auto d_settings = settings;
+    d_settings.iter_max = settings.iter_max - iter;
+    d_settings.time_max = settings.time_max - t;
+    d_settings.resume = true;
+
+    if (settings.print)
+    {
+        printf("Double precision phase\n");
+    }
+
+    return method.optimize(problem, point, d_settings, state);
+}
+
+}
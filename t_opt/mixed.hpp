@@ -0,0 +1,31 @@
+#pragma once
+
+#include "core/method.hpp"
+
+namespace t_opt
+{
+
+struct MixedSettings
+{
+    // Single precision phase ends when gradient norm is below noise_k times the difference
+    // between float and double gradients. The difference is measured once at the start point,
+    // so this is a fixed threshold, noise growing along the way is caught by progress_min only.
+    double noise_k = 10.0;
+
+    // or when f relative decrease over progress_window iterations is below progress_min
+    double progress_min = 1e-6;
+    size_t progress_window = 50;
+};
+
+// Starts optimization with single precision problem and method, then carries the point over to
+// double precision ones when float rounding errors start to dominate. Both problems should be
+// the same problem instantiated for float and double, state accumulates both phases.
+// Returns exit reason of the last phase.
+ExitReason
+optimize_mixed(
+    FMethod& f_method, FProblem& f_problem,
+    Method& method, Problem& problem,
+    Point& point, const MethodSettings& settings, State& state,
+    const MixedSettings& mixed = MixedSettings());
+
+}
@@ -0,0 +1,45 @@
+#include "sweep.hpp"
+
+#include "core/problem.hpp"
+
+namespace t_opt
+{
+
+ExitReason
+optimize_sweep(
+    Method& method, Problem& problem, Point& point, size_t count,
+    const SweepStep& step, const SweepSolved& solved,
+    const MethodSettings& settings, State& state)
+{
+    auto reason = ExitReason::NoRelaxation;
+    for (size_t k = 0; k < count; ++k)
+    {
+        step(k);
+
+        if (settings.print)
+        {
+            printf("Sweep step %zu of %zu\n", k + 1, count);
+        }
+
+        // limits are relative to the state totals, so every step gets them in full, while
+        // iterations, time and log are continued after the first step
+        auto step_settings = settings;
+        step_settings.resume = settings.resume || k > 0;
+
+        reason = method.optimize(problem, point, step_settings, state);
+
+        if (solved)
+        {
+            solved(k, point, reason);
+        }
+
+        if (reason == ExitReason::Error)
+        {
+            break;
+        }
+    }
+
+    return reason;
+}
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "core/method.hpp"
+
+#include <functional>
+
+namespace t_opt
+{
+
+// Called with index of the sweep step, switches the problem to its parameter value
+using SweepStep = std::function<void(size_t step)>;
+
+// Called with index of the sweep step and its solution
+using SweepSolved = std::function<void(size_t step, const Point& point, ExitReason reason)>;
+
+// Solves count problems that differ by one parameter (mu of SmVSDM2, demand scale), every
+// solve starts from the solution of the previous one. Neighbouring steps should be close, e.g.
+// mu should decrease. Settings limits are applied to every step, state accumulates all of them.
+// Stops at the first Error and returns the exit reason of the last step.
+ExitReason
+optimize_sweep(
+    Method& method, Problem& problem, Point& point, size_t count,
+    const SweepStep& step, const SweepSolved& solved,
+    const MethodSettings& settings, State& state);
+
+}
@@ -2,59 +2,204 @@
 
 #include "core/blas.hpp"
 #include "core/chrono.hpp"
+#include "core/perf.hpp"
 #include "core/types.hpp"
 #include "core/problem.hpp"
 
+#include <algorithm>
+
 namespace t_opt
 {
 
-void
-speed_test(Problem& problem, Point& point, long count)
+const char*
+to_string(Kernel kernel)
 {
+    switch (kernel)
     {
-        double f_sum = 0.0;
-        auto t_0 = chrono::now();
-        for (long i = 0; i < count; ++i)
+        case Kernel::F:   return "f";
+        case Kernel::DF:  return "df";
+        case Kernel::FDF: return "fdf";
+    }
+
+    // -Wreturn-type warning fix
+    return "";
+}
+
+double
+axpy_bandwidth()
+{
+    static const size_t SIZE = 1 << 23;
+    static const int RUNS = 5;
+
+    DVector x = DVector::Constant(SIZE, 1.0);
+    DVector y = DVector::Zero(SIZE);
+
+    uint64_t best = limits<uint64_t>::max();
+    for (int i = 0; i < RUNS; ++i)
+    {
+        const auto t_0 = chrono::ns();
+        blas::axpy(1e-3, x, y);
+        best = std::min(best, chrono::ns() - t_0);
+    }
+
+    // read x, y and write y, bytes per ns == GB/s
+    return 3.0 * sizeof(double) * SIZE / best;
+}
+
+template <typename T>
+KernelProfile
+profile_kernel(BasicProblem<T>& problem, BasicPoint<T>& point, Kernel kernel, long count, long warmup,
+               PerfCounters* counters)
+{
+    auto call = [&problem, &point, kernel]()
+    {
+        switch (kernel)
         {
-            problem.f(point);
-            f_sum += point.f;
+            case Kernel::F:   problem.f(point);   break;
+            case Kernel::DF:  problem.df(point);  break;
+            case Kernel::FDF: problem.fdf(point); break;
         }
-        auto f_t = chrono::ms(t_0);
-        printf("f time = %.3f ms. f_sum = %e\n", f_t, f_sum);
+    };
+
+    for (long i = 0; i < warmup; ++i)
+    {
+        call();
     }
 
+    count = std::max(1l, count);
+    std::vector<uint64_t> ns(count);
+
+    if (counters)
     {
-        double g_nrm2_sum = 0.0;
-        auto t_0 = chrono::now();
-        for (long i = 0; i < count; ++i)
+        counters->start();
+    }
+
+    for (long i = 0; i < count; ++i)
+    {
+        const auto t_0 = chrono::ns();
+        call();
+        ns[i] = chrono::ns() - t_0;
+    }
+
+    if (counters)
+    {
+        counters->stop();
+    }
+
+    double total = 0.0;
+    for (auto t : ns)
+    {
+        total += t;
+    }
+
+    std::sort(ns.begin(), ns.end());
+    auto quantile = [&ns](double q)
+    {
+        return 1e-9 * ns[std::min(ns.size() - 1, size_t(q * ns.size()))];
+    };
+
+    KernelProfile profile;
+    profile.count = count;
+    profile.mean = 1e-9 * total / count;
+    profile.p50 = quantile(0.5);
+    profile.p90 = quantile(0.9);
+    profile.p99 = quantile(0.99);
+    profile.max = 1e-9 * ns.back();
+
+    switch (kernel)
+    {
+        case Kernel::F:   profile.bytes = problem.f_bytes();   break;
+        case Kernel::DF:  profile.bytes = problem.df_bytes();  break;
+        case Kernel::FDF: profile.bytes = problem.fdf_bytes(); break;
+    }
+
+    return profile;
+}
+
+static void
+print_profile(Kernel kernel, const KernelProfile& profile, const PerfCounters& counters, double bandwidth)
+{
+    printf("%-4s %8ld %10.2f %10.2f %10.2f %10.2f %10.2f", to_string(kernel), profile.count,
+           1e6 * profile.mean, 1e6 * profile.p50, 1e6 * profile.p90, 1e6 * profile.p99, 1e6 * profile.max);
+
+    if (profile.bytes > 0.0)
+    {
+        printf(" %10.3f %8.2f %6.1f%%", 1e-6 * profile.bytes, profile.gb_s(), 100.0 * profile.gb_s() / bandwidth);
+    }
+    printf("\n");
+
+    if (counters.any())
+    {
+        printf("     ");
+        for (size_t i = 0; i < PerfCounters::EVENTS; ++i)
         {
-            problem.df(point);
-            g_nrm2_sum += point.g_nrm2;
+            const auto event = PerfEvent(i);
+            if (counters.available(event))
+            {
+                printf(" %s/call = %.4g;", to_string(event), double(counters.value(event)) / profile.count);
+            }
         }
-        auto g_t = chrono::ms(t_0);
-        printf("g time = %.3f ms. g_nrm2_sum = %e\n", g_t, g_nrm2_sum);
+
+        const auto cycles = counters.value(PerfEvent::Cycles);
+        if (cycles != 0 && counters.available(PerfEvent::Instructions))
+        {
+            printf(" ipc = %.2f", double(counters.value(PerfEvent::Instructions)) / cycles);
+        }
+        printf("\n");
     }
 }
 
+template <typename T>
 void
-g_test(Problem& problem, Point& point)
+speed_test(BasicProblem<T>& problem, BasicPoint<T>& point, long count, long warmup)
+{
+    PerfCounters counters;
+    if (counters.any() == false)
+    {
+        printf("Perf events are not available (see /proc/sys/kernel/perf_event_paranoid), "
+               "hardware counters are skipped\n");
+    }
+    else if (problem.threads() > 1)
+    {
+        printf("Perf counters cover the calling thread only, work of the other %zu evaluation threads "
+               "is not counted\n", problem.threads() - 1);
+    }
+
+    const auto bandwidth = axpy_bandwidth();
+    printf("axpy bandwidth = %.2f GB/s\n", bandwidth);
+
+    printf("%-4s %8s %10s %10s %10s %10s %10s %10s %8s %7s\n",
+           "", "calls", "mean, us", "p50, us", "p90, us", "p99, us", "max, us", "MB/call", "GB/s", "axpy");
+
+    for (auto kernel : {Kernel::F, Kernel::DF, Kernel::FDF})
+    {
+        const auto profile = profile_kernel(problem, point, kernel, count, warmup, &counters);
+        print_profile(kernel, profile, counters, bandwidth);
+    }
+
+    blas::norms(point.g, point.g_nrm_1, point.g_nrm2_2, point.g_nrm_inf);
+    printf("f = %e g_nrm2 = %e\n", point.f, std::sqrt(point.g_nrm2_2));
+}
+
+template <typename T>
+void
+g_test(BasicProblem<T>& problem, BasicPoint<T>& point)
 {
     const double h_max = 1e-1;
     const double h_min = limits<double>::epsilon();
 
     problem.f(point);
-    blas::set_zero(point.g); // FIXME use wrapped problem here
     problem.df(point);
 
     const auto f0 = point.f;
-    DVector g0(problem.size());
+    Vector<T> g0(problem.size());
     blas::copy(point.g, g0);
 
-    DVector g1(problem.size());
-    DVector g2(problem.size());
-    DVector g3(problem.size());
+    Vector<T> g1(problem.size());
+    Vector<T> g2(problem.size());
+    Vector<T> g3(problem.size());
 
-    auto delta = [](const DVector& x, const DVector& y)
+    auto delta = [](const Vector<T>& x, const Vector<T>& y)
     {
         double res = 0.0;
         for (int i = 0; i < x.size(); ++i)
@@ -105,4 +250,15 @@ g_test(Problem& problem, Point& point)
     }
 }
 
+template KernelProfile profile_kernel(
+    Problem& problem, Point& point, Kernel kernel, long count, long warmup, PerfCounters* counters);
+template KernelProfile profile_kernel(
+    FProblem& problem, FPoint& point, Kernel kernel, long count, long warmup, PerfCounters* counters);
+
+template void speed_test(Problem& problem, Point& point, long count, long warmup);
+template void speed_test(FProblem& problem, FPoint& point, long count, long warmup);
+
+template void g_test(Problem& problem, Point& point);
+template void g_test(FProblem& problem, FPoint& point);
+
 }
@@ -1,15 +1,65 @@
 #pragma once
 
+#include "core/types.hpp"
+
 namespace t_opt
 {
 
-class Point;
-class Problem;
+class PerfCounters;
+
+enum class Kernel : uint8_t
+{
+    F,
+    DF,
+    FDF,
+};
+
+const char*
+to_string(Kernel kernel);
+
+// Times of a kernel call in seconds
+struct KernelProfile
+{
+    long count = 0;
+
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+
+    // estimated bytes moved by a call (see Problem::f_bytes()), 0 if unknown
+    double bytes = 0.0;
+
+    inline double
+    gb_s() const
+    {
+        return mean > 0.0 ? 1e-9 * bytes / mean : 0.0;
+    }
+};
+
+// Memory bandwidth (GB/s) of axpy over vectors much larger than caches, reference for kernels
+double
+axpy_bandwidth();
+
+// defined for double and float problems
+
+// Times count calls of the kernel after warmup ones, counters are running during timed calls only
+template <typename T>
+KernelProfile
+profile_kernel(BasicProblem<T>& problem, BasicPoint<T>& point, Kernel kernel, long count, long warmup,
+               PerfCounters* counters = nullptr);
 
+// Profiles f(), df() and fdf(): per call latency percentiles after warmup calls, achieved
+// bandwidth (see Problem::f_bytes()) relative to axpy one and hardware counters when perf
+// events are available. Counters cover the calling thread only, with problem threads > 1 the
+// printed values miss the work of the other threads (a note is printed).
+template <typename T>
 void
-speed_test(Problem& problem, Point& point, long count);
+speed_test(BasicProblem<T>& problem, BasicPoint<T>& point, long count, long warmup = 10);
 
+template <typename T>
 void
-g_test(Problem& problem, Point& point);
+g_test(BasicProblem<T>& problem, BasicPoint<T>& point);
 
 }
@@ -0,0 +1,630 @@
+// Runs every combination of problems, networks, mu values, methods and line searches
+// described by a matrix file and prints a results table.
+//
+// Matrix file consists of "key = item, item, ..." lines, '#' starts a comment:
+//
+//   path          = /data/TNTP          # TNTP networks directory
+//   networks      = SiouxFalls, Anaheim
+//   layout        = NodeMajor           # or SourceMajor (default)
+//   problems      = SmVSDM2, TSDM, LPSDM, Quadratic:1000
+//   mu            = 1e1, 1e0            # SmVSDM2 only
+//   methods       = GDM, CG:PRP, CG:*, LBFGS:3, AFGM, AGMsDR:1e-4, FGM, UFGM:1e-4
+//   line_searches = HSimple, HSimple:0.5:2.0, Parabolic:2:g, Parabolic:3
+//   g_nrm2_min    = 1e-5                # tolerance of time-to-tolerance column
+//   gap_min       = 1e-3                # also stop by duality gap, SmVSDM2 with FGM family only
+//   gap_g_nrm2_min = 1e-5               # infeasibility of averaged flows required with gap_min
+//   time_max      = 60
+//   iter_max      = 100000
+//   threads       = 1                   # threads of every problem and blas
+//   jobs          = 1                   # cells running in parallel
+//
+// CG:* expands into all CG variants. Line searches are combined with methods which use them
+// only. Cells running in parallel share memory bandwidth, so use jobs > 1 to compare counts
+// and exit reasons rather than times. Jobs run on the shared ThreadPool, so problems of
+// parallel cells are evaluated serially whatever threads is.
+
+#include "line_search/h_simple.hpp"
+#include "line_search/parabolic.hpp"
+
+#include "local/afgm.hpp"
+#include "local/agmsdr.hpp"
+#include "local/cg.hpp"
+#include "local/fgm.hpp"
+#include "local/gdm.hpp"
+#include "local/lbfgs.hpp"
+#include "local/ufgm.hpp"
+
+#include "core/blas.hpp"
+#include "core/thread_pool.hpp"
+
+#include "problems/quadratic.hpp"
+
+#include "problems/transport/lpsdm.hpp"
+#include "problems/transport/smvsdm2.hpp"
+#include "problems/transport/tsdm.hpp"
+
+#include <fmt/format.h>
+
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+using namespace t_opt;
+
+using Items = std::vector<String>;
+
+struct Matrix
+{
+    String path = ".";
+    Items networks;
+    transport::Layout layout = transport::Layout::SourceMajor;
+    Items problems;
+    std::vector<double> mu;
+    Items methods;
+    Items line_searches;
+
+    MethodSettings settings;
+    size_t threads = 1;
+    size_t jobs = 1;
+};
+
+struct Cell
+{
+    String network;
+    String problem;
+    double mu;
+    String method;
+    String line_search;
+
+    // results
+    String exit;
+    double time = 0.0;
+    size_t iter = 0;
+    double f = limits<double>::quiet_NaN();
+    double g_nrm2 = limits<double>::quiet_NaN();
+    size_t f_count = 0;
+    size_t g_count = 0;
+    bool converged = false;
+};
+
+static String
+trim(const String& s)
+{
+    const auto b = s.find_first_not_of(" \t\r");
+    const auto e = s.find_last_not_of(" \t\r");
+    return b == String::npos ? String() : s.substr(b, e - b + 1);
+}
+
+static Items
+split(const String& s, char delimiter)
+{
+    Items items;
+
+    size_t b = 0;
+    while (true)
+    {
+        const auto e = s.find(delimiter, b);
+        const auto item = trim(s.substr(b, e == String::npos ? String::npos : e - b));
+        if (item.empty() == false)
+        {
+            items.push_back(item);
+        }
+
+        if (e == String::npos)
+        {
+            return items;
+        }
+
+        b = e + 1;
+    }
+}
+
+static double
+to_double(const String& s)
+{
+    size_t end = 0;
+    const auto value = std::stod(s, &end);
+    if (end != s.size())
+    {
+        throw std::invalid_argument(fmt::format("'{}' is not a number", s));
+    }
+
+    return value;
+}
+
+static Matrix
+read_matrix(const String& file_name)
+{
+    std::ifstream file(file_name);
+    if (file.is_open() == false)
+    {
+        throw std::runtime_error(fmt::format("can't open matrix file '{}'", file_name));
+    }
+
+    Matrix matrix;
+    matrix.settings.print = false;
+    matrix.settings.log_format = LogFormat::None;
+
+    String line;
+    size_t line_num = 0;
+    while (std::getline(file, line))
+    {
+        line_num += 1;
+        line = trim(line.substr(0, line.find('#')));
+        if (line.empty())
+        {
+            continue;
+        }
+
+        const auto eq = line.find('=');
+        if (eq == String::npos)
+        {
+            throw std::runtime_error(fmt::format("{}:{}: 'key = value' expected", file_name, line_num));
+        }
+
+        const auto key = trim(line.substr(0, eq));
+        const auto value = trim(line.substr(eq + 1));
+        const auto items = split(value, ',');
+
+        if (key == "path")
+        {
+            matrix.path = value;
+        }
+        else if (key == "networks")
+        {
+            matrix.networks = items;
+        }
+        else if (key == "layout")
+        {
+            if (value != "NodeMajor" && value != "SourceMajor")
+            {
+                throw std::runtime_error(fmt::format("{}:{}: unknown layout '{}'", file_name, line_num, value));
+            }
+
+            matrix.layout = value == "NodeMajor" ? transport::Layout::NodeMajor : transport::Layout::SourceMajor;
+        }
+        else if (key == "problems")
+        {
+            matrix.problems = items;
+        }
+        else if (key == "mu")
+        {
+            for (const auto& item : items)
+            {
+                matrix.mu.push_back(to_double(item));
+            }
+        }
+        else if (key == "methods")
+        {
+            for (const auto& item : items)
+            {
+                if (item != "CG:*")
+                {
+                    matrix.methods.push_back(item);
+                    continue;
+                }
+
+                for (auto v : {local::CgVariant::HS, local::CgVariant::FR, local::CgVariant::PRP,
+                               local::CgVariant::PRPplus, local::CgVariant::CD, local::CgVariant::LS,
+                               local::CgVariant::DY})
+                {
+                    matrix.methods.push_back("CG:" + local::to_string(v));
+                }
+            }
+        }
+        else if (key == "line_searches")
+        {
+            matrix.line_searches = items;
+        }
+        else if (key == "g_nrm2_min")
+        {
+            matrix.settings.g_nrm2_min = to_double(value);
+        }
+        else if (key == "gap_min")
+        {
+            matrix.settings.gap_min = to_double(value);
+        }
+        else if (key == "gap_g_nrm2_min")
+        {
+            matrix.settings.gap_g_nrm2_min = to_double(value);
+        }
+        else if (key == "time_max")
+        {
+            matrix.settings.time_max = to_double(value);
+        }
+        else if (key == "iter_max")
+        {
+            matrix.settings.iter_max = size_t(to_double(value));
+        }
+        else if (key == "threads")
+        {
+            matrix.threads = std::max(1.0, to_double(value));
+        }
+        else if (key == "jobs")
+        {
+            matrix.jobs = std::max(1.0, to_double(value));
+        }
+        else
+        {
+            throw std::runtime_error(fmt::format("{}:{}: unknown key '{}'", file_name, line_num, key));
+        }
+    }
+
+    if (matrix.line_searches.empty())
+    {
+        matrix.line_searches.push_back("HSimple");
+    }
+
+    if (matrix.mu.empty())
+    {
+        matrix.mu.push_back(1.0);
+    }
+
+    return matrix;
+}
+
+static bool
+uses_line_search(const String& method)
+{
+    const auto name = split(method, ':').at(0);
+    return name != "FGM" && name != "UFGM";
+}
+
+static bool
+uses_network(const String& problem)
+{
+    return split(problem, ':').at(0) != "Quadratic";
+}
+
+static std::vector<Cell>
+make_cells(const Matrix& matrix)
+{
+    std::vector<Cell> cells;
+
+    for (const auto& problem : matrix.problems)
+    {
+        const auto networks = uses_network(problem) ? matrix.networks : Items{"-"};
+        const auto mus = problem == "SmVSDM2" ? matrix.mu : std::vector<double>{limits<double>::quiet_NaN()};
+
+        for (const auto& network : networks)
+        {
+            for (auto mu : mus)
+            {
+                for (const auto& method : matrix.methods)
+                {
+                    const auto line_searches = uses_line_search(method) ? matrix.line_searches : Items{"-"};
+                    for (const auto& line_search : line_searches)
+                    {
+                        Cell cell;
+                        cell.network = network;
+                        cell.problem = problem;
+                        cell.mu = mu;
+                        cell.method = method;
+                        cell.line_search = line_search;
+
+                        cells.push_back(cell);
+                    }
+                }
+            }
+        }
+    }
+
+    return cells;
+}
+
+static std::unique_ptr<Problem>
+make_problem(const Matrix& matrix, const Cell& cell)
+{
+    const auto args = split(cell.problem, ':');
+    const auto& name = args.at(0);
+
+    if (name == "SmVSDM2")
+    {
+        std::unique_ptr<transport::SmVSDM2> problem(
+            new transport::SmVSDM2(matrix.path, cell.network, matrix.layout));
+        problem->set_mu(cell.mu);
+        return std::unique_ptr<Problem>(problem.release());
+    }
+
+    if (name == "TSDM")
+    {
+        std::unique_ptr<transport::TSDM> problem(new transport::TSDM(matrix.path, cell.network, matrix.layout));
+        return std::unique_ptr<Problem>(problem.release());
+    }
+
+    if (name == "LPSDM")
+    {
+        std::unique_ptr<transport::LPSDM> problem(new transport::LPSDM(matrix.path, cell.network, matrix.layout));
+        return std::unique_ptr<Problem>(problem.release());
+    }
+
+    if (name == "Quadratic")
+    {
+        return std::unique_ptr<Problem>(new problem::Quadratic(args.size() > 1 ? to_double(args[1]) : 100));
+    }
+
+    throw std::invalid_argument(fmt::format("unknown problem '{}'", cell.problem));
+}
+
+static std::unique_ptr<LineSearchMethod>
+make_line_search(const String& line_search)
+{
+    const auto args = split(line_search, ':');
+    const auto& name = args.at(0);
+
+    if (name == "HSimple")
+    {
+        if (args.size() == 3)
+        {
+            return std::unique_ptr<LineSearchMethod>(
+                new line_search::HSimple(to_double(args[1]), to_double(args[2])));
+        }
+
+        return std::unique_ptr<LineSearchMethod>(new line_search::HSimple());
+    }
+
+    if (name == "Parabolic")
+    {
+        const auto probes = args.size() > 1 ? uint8_t(to_double(args[1])) : uint8_t(3);
+        const auto use_gradient = args.size() > 2 && args[2] == "g";
+        return std::unique_ptr<LineSearchMethod>(new line_search::Parabolic(probes, use_gradient));
+    }
+
+    throw std::invalid_argument(fmt::format("unknown line search '{}'", line_search));
+}
+
+static std::unique_ptr<Method>
+make_method(const String& method, LineSearchMethod* ls)
+{
+    const auto args = split(method, ':');
+    const auto& name = args.at(0);
+
+    auto arg = [&args](double default_value)
+    {
+        return args.size() > 1 ? to_double(args[1]) : default_value;
+    };
+
+    if (name == "GDM")
+    {
+        return std::unique_ptr<Method>(new local::GDM(*ls));
+    }
+
+    if (name == "CG")
+    {
+        for (auto v : {local::CgVariant::HS, local::CgVariant::FR, local::CgVariant::PRP,
+                       local::CgVariant::PRPplus, local::CgVariant::CD, local::CgVariant::LS,
+                       local::CgVariant::DY})
+        {
+            if (args.size() > 1 && args[1] == local::to_string(v))
+            {
+                return std::unique_ptr<Method>(new local::CG(v, *ls));
+            }
+        }
+
+        throw std::invalid_argument(fmt::format("unknown CG variant in '{}'", method));
+    }
+
+    if (name == "LBFGS")
+    {
+        return std::unique_ptr<Method>(new local::LBFGS(uint32_t(arg(3)), *ls));
+    }
+
+    if (name == "AFGM")
+    {
+        return std::unique_ptr<Method>(new local::AFGM(*ls));
+    }
+
+    if (name == "AGMsDR")
+    {
+        return std::unique_ptr<Method>(new local::AGMsDR(*ls, arg(1e-4)));
+    }
+
+    if (name == "FGM")
+    {
+        return std::unique_ptr<Method>(new local::FGM());
+    }
+
+    if (name == "UFGM")
+    {
+        return std::unique_ptr<Method>(new local::UFGM(arg(1e-4)));
+    }
+
+    throw std::invalid_argument(fmt::format("unknown method '{}'", method));
+}
+
+static void
+run_cell(const Matrix& matrix, Cell& cell)
+{
+    try
+    {
+        auto problem = make_problem(matrix, cell);
+        problem->set_threads(matrix.threads);
+        auto ls = uses_line_search(cell.method) ? make_line_search(cell.line_search) : nullptr;
+        auto method = make_method(cell.method, ls.get());
+
+        auto point = Point(*problem);
+        auto state = State();
+
+        const auto reason = method->optimize(*problem, point, matrix.settings, state);
+
+        cell.exit = to_string(reason);
+        cell.converged = reason == ExitReason::GradientNormValue || reason == ExitReason::DualityGap;
+        cell.time = state.t_total;
+        cell.iter = state.iter_total;
+        cell.f = point.f;
+        cell.g_nrm2 = point.g_nrm2;
+        cell.f_count = state.f_count;
+        cell.g_count = state.g_count;
+    }
+    catch (std::exception& e)
+    {
+        cell.exit = fmt::format("error: {}", e.what());
+    }
+}
+
+static String
+mu_string(const Cell& cell)
+{
+    return std::isnan(cell.mu) ? String("-") : fmt::format("{:g}", cell.mu);
+}
+
+static void
+print_cell(FILE* file, const Cell& cell, bool csv)
+{
+    const auto mu = mu_string(cell);
+    const auto tol = cell.converged ? fmt::format("{:.3f}", cell.time) : String("-");
+
+    const char* format = csv
+        ? "%s;%s;%s;%s;%s;%s;%.3f;%zu;%.10e;%.6e;%zu;%zu;%s\n"
+        : "%-16s %-12s %-6s %-10s %-16s %10s %10.3f %9zu % .10e %.6e %9zu %9zu %s\n";
+
+    fprintf(file, format,
+            cell.network.c_str(), cell.problem.c_str(), mu.c_str(), cell.method.c_str(), cell.line_search.c_str(),
+            tol.c_str(), cell.time, cell.iter, cell.f, cell.g_nrm2, cell.f_count, cell.g_count, cell.exit.c_str());
+}
+
+static void
+print_header(FILE* file, bool csv)
+{
+    const char* format = csv
+        ? "%s;%s;%s;%s;%s;%s;%s;%s;%s;%s;%s;%s;%s\n"
+        : "%-16s %-12s %-6s %-10s %-16s %10s %10s %9s %-17s %-12s %9s %9s %s\n";
+
+    fprintf(file, format,
+            "network", "problem", "mu", "method", "line_search",
+            "t_tol", "time", "iter", "f", "g_nrm2", "f_count", "g_count", "exit");
+}
+
+static void
+print_usage()
+{
+    printf("Usage: t_opt_bench [-j jobs] [-o results.csv] matrix.txt\n"
+           "  -j jobs  cells running in parallel, overrides 'jobs' of the matrix\n"
+           "  -o file  also write results as csv\n");
+}
+
+int
+main(int argc, char** argv)
+{
+    String matrix_name;
+    String csv_name;
+    size_t jobs = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+        {
+            jobs = std::max(1l, std::atol(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            csv_name = argv[++i];
+        }
+        else if (argv[i][0] != '-' && matrix_name.empty())
+        {
+            matrix_name = argv[i];
+        }
+        else
+        {
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (matrix_name.empty())
+    {
+        print_usage();
+        return 1;
+    }
+
+    try
+    {
+        auto matrix = read_matrix(matrix_name);
+        if (jobs > 0)
+        {
+            matrix.jobs = jobs;
+        }
+
+        auto cells = make_cells(matrix);
+        printf("%zu cells, %zu jobs\n", cells.size(), matrix.jobs);
+
+        // pool threads should be there before cells set their threads
+        ThreadPool::reserve_shared(std::max(matrix.jobs, matrix.threads));
+        blas::set_threads(matrix.threads);
+
+        std::mutex print_mutex;
+        size_t done = 0;
+
+        auto job = [&](size_t i, size_t)
+        {
+            run_cell(matrix, cells[i]);
+
+            std::lock_guard<std::mutex> lock(print_mutex);
+            done += 1;
+            printf("[%zu/%zu] %s %s %s %s: %s\n", done, cells.size(),
+                   cells[i].network.c_str(), cells[i].problem.c_str(),
+                   cells[i].method.c_str(), cells[i].line_search.c_str(), cells[i].exit.c_str());
+            fflush(stdout);
+        };
+
+        ThreadPool::shared().run(cells.size(), job, matrix.jobs);
+
+        printf("\n");
+        print_header(stdout, false);
+        for (const auto& cell : cells)
+        {
+            print_cell(stdout, cell, false);
+        }
+
+        // fastest converged cell of every network, problem and mu
+        std::map<Items, const Cell*> best;
+        for (const auto& cell : cells)
+        {
+            auto& b = best[{cell.network, cell.problem, mu_string(cell)}];
+            if (cell.converged && (b == nullptr || cell.time < b->time))
+            {
+                b = &cell;
+            }
+        }
+
+        printf("\nBest by time to tolerance:\n");
+        for (const auto& b : best)
+        {
+            if (b.second)
+            {
+                print_cell(stdout, *b.second, false);
+            }
+            else
+            {
+                printf("%-16s %-12s %-6s no converged cells\n",
+                       b.first[0].c_str(), b.first[1].c_str(), b.first[2].c_str());
+            }
+        }
+
+        if (csv_name.empty() == false)
+        {
+            auto file = fopen(csv_name.c_str(), "w");
+            if (file == nullptr)
+            {
+                throw std::runtime_error(fmt::format("can't open '{}'", csv_name));
+            }
+
+            print_header(file, true);
+            for (const auto& cell : cells)
+            {
+                print_cell(file, cell, true);
+            }
+            fclose(file);
+        }
+
+        return 0;
+    }
+    catch (std::exception& e)
+    {
+        printf("%s\n", e.what());
+        return -1;
+    }
+}
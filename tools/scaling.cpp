@@ -0,0 +1,316 @@
+// Strong and weak scaling of transport problems over thread counts.
+//
+// For every thread count the problem kernels (f, df, fdf) are profiled with profile_kernel()
+// and a fixed number of LBFGS iterations is run, every measurement is repeated. Results go to
+// a csv file (and stdout): median and min time, speedup and parallel efficiency relative to
+// the smallest thread count, achieved bandwidth.
+//
+// Strong scaling uses the same network for all thread counts. Weak scaling (-w) takes a network
+// name pattern, '%t' is replaced by the thread count, so networks should grow with threads
+// (see t_opt_tntp_gen), speedup is the scaled one then.
+
+#include "line_search/h_simple.hpp"
+#include "local/lbfgs.hpp"
+
+#include "core/blas.hpp"
+
+#include "problems/transport/smvsdm2.hpp"
+#include "problems/transport/tsdm.hpp"
+
+#include "utils.hpp"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+using namespace t_opt;
+
+struct Options
+{
+    String path;
+    String network;
+    String problem = "SmVSDM2";
+    transport::Layout layout = transport::Layout::NodeMajor;
+    double mu = 1.0;
+
+    std::vector<size_t> threads;
+    bool weak = false;
+    bool pin = true;
+
+    long calls = 20;
+    long repeats = 5;
+    size_t iters = 100;
+
+    String output = "scaling.csv";
+};
+
+// One measured configuration, times are medians and minimums over repeats
+struct Row
+{
+    String network;
+    size_t threads;
+    String what;
+    long calls;
+    double median;
+    double min;
+    double bytes;
+};
+
+static std::unique_ptr<transport::SDM>
+make_problem(const Options& options, const String& network)
+{
+    if (options.problem == "SmVSDM2")
+    {
+        std::unique_ptr<transport::SmVSDM2> problem(new transport::SmVSDM2(options.path, network, options.layout));
+        problem->set_mu(options.mu);
+        return std::unique_ptr<transport::SDM>(problem.release());
+    }
+
+    if (options.problem == "TSDM")
+    {
+        return std::unique_ptr<transport::SDM>(new transport::TSDM(options.path, network, options.layout));
+    }
+
+    throw std::invalid_argument(fmt::format("unknown problem '{}'", options.problem));
+}
+
+static std::pair<double, double>
+median_min(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return {values[values.size() / 2], values.front()};
+}
+
+static void
+measure(const Options& options, const String& network, size_t threads, std::vector<Row>& rows)
+{
+    auto problem = make_problem(options, network);
+    problem->set_threads(threads, options.pin);
+    blas::set_threads(threads, options.pin);
+
+    Point start(*problem);
+    srand(1);
+    start.x.setRandom();
+
+    for (auto kernel : {Kernel::F, Kernel::DF, Kernel::FDF})
+    {
+        auto point = start;
+
+        std::vector<double> times;
+        KernelProfile profile;
+        for (long r = 0; r < options.repeats; ++r)
+        {
+            profile = profile_kernel(*problem, point, kernel, options.calls, r == 0 ? 2 : 0);
+            times.push_back(profile.mean);
+        }
+
+        const auto t = median_min(times);
+        rows.push_back({network, threads, to_string(kernel), options.calls, t.first, t.second, profile.bytes});
+    }
+
+    if (options.iters == 0)
+    {
+        return;
+    }
+
+    auto settings = MethodSettings();
+    settings.g_nrm2_min = 0.0;
+    settings.iter_max = options.iters;
+    settings.print = false;
+    settings.log_format = LogFormat::None;
+
+    std::vector<double> times;
+    double bytes = 0.0;
+    for (long r = 0; r < options.repeats; ++r)
+    {
+        auto point = start;
+        auto state = State();
+        auto ls = line_search::HSimple();
+        auto method = local::LBFGS(3, ls);
+
+        method.optimize(*problem, point, settings, state);
+
+        // per iteration, vector operations of the method are not counted in bytes
+        times.push_back(state.t_total / state.iter_total);
+        bytes = (state.f_count * problem->f_bytes() + state.g_count * problem->df_bytes()) / state.iter_total;
+    }
+
+    const auto t = median_min(times);
+    rows.push_back({network, threads, "lbfgs_iter", long(options.iters), t.first, t.second, bytes});
+}
+
+static void
+write_rows(FILE* file, const Options& options, const std::vector<Row>& rows)
+{
+    fprintf(file, "mode;problem;network;threads;what;calls;repeats;median_s;min_s;speedup;efficiency;gb_s\n");
+
+    for (const auto& row : rows)
+    {
+        // baseline is the same measurement at the smallest thread count
+        const Row* base = nullptr;
+        for (const auto& r : rows)
+        {
+            if (r.what == row.what && (base == nullptr || r.threads < base->threads))
+            {
+                base = &r;
+            }
+        }
+
+        const auto ratio = base->median / row.median;
+        const auto n = double(row.threads) / base->threads;
+
+        // strong: speedup = T_0 / T_n, weak: efficiency = T_0 / T_n
+        const auto speedup = options.weak ? ratio * n : ratio;
+        const auto efficiency = options.weak ? ratio : ratio / n;
+
+        fprintf(file, "%s;%s;%s;%zu;%s;%ld;%ld;%.6e;%.6e;%.3f;%.3f;%.3f\n",
+                options.weak ? "weak" : "strong", options.problem.c_str(), row.network.c_str(), row.threads,
+                row.what.c_str(), row.calls, options.repeats, row.median, row.min, speedup, efficiency,
+                row.median > 0.0 ? 1e-9 * row.bytes / row.median : 0.0);
+    }
+}
+
+static void
+print_usage()
+{
+    printf("Usage: t_opt_scaling [options] path network\n"
+           "  -t 1,2,4      thread counts, default is powers of 2 up to the number of CPUs\n"
+           "  -w            weak scaling, '%%t' in network is replaced by the thread count\n"
+           "  -p problem    SmVSDM2 (default) or TSDM\n"
+           "  -l layout     NodeMajor (default) or SourceMajor\n"
+           "  -m mu         SmVSDM2 mu (1)\n"
+           "  -c calls      kernel calls per measurement (20)\n"
+           "  -r repeats    repeats of every measurement (5)\n"
+           "  -i iters      LBFGS iterations per run, 0 disables runs (100)\n"
+           "  -o file       csv file (scaling.csv)\n"
+           "  -n            don't pin threads to CPUs\n");
+}
+
+int
+main(int argc, char** argv)
+{
+    Options options;
+    std::vector<String> names;
+
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const String arg = argv[i];
+            const bool has_value = i + 1 < argc;
+
+            if (arg == "-w")
+            {
+                options.weak = true;
+            }
+            else if (arg == "-n")
+            {
+                options.pin = false;
+            }
+            else if (arg == "-t" && has_value)
+            {
+                const String list = argv[++i];
+                for (size_t b = 0; b < list.size(); )
+                {
+                    auto e = std::min(list.find(',', b), list.size());
+                    options.threads.push_back(std::max(1ul, std::stoul(list.substr(b, e - b))));
+                    b = e + 1;
+                }
+            }
+            else if (arg == "-p" && has_value)
+            {
+                options.problem = argv[++i];
+            }
+            else if (arg == "-l" && has_value)
+            {
+                const String layout = argv[++i];
+                options.layout = layout == "SourceMajor" ? transport::Layout::SourceMajor : transport::Layout::NodeMajor;
+            }
+            else if (arg == "-m" && has_value)
+            {
+                options.mu = std::stod(argv[++i]);
+            }
+            else if (arg == "-c" && has_value)
+            {
+                options.calls = std::max(1l, std::atol(argv[++i]));
+            }
+            else if (arg == "-r" && has_value)
+            {
+                options.repeats = std::max(1l, std::atol(argv[++i]));
+            }
+            else if (arg == "-i" && has_value)
+            {
+                options.iters = std::atol(argv[++i]);
+            }
+            else if (arg == "-o" && has_value)
+            {
+                options.output = argv[++i];
+            }
+            else if (arg[0] != '-')
+            {
+                names.push_back(arg);
+            }
+            else
+            {
+                print_usage();
+                return 1;
+            }
+        }
+
+        if (names.size() != 2)
+        {
+            print_usage();
+            return 1;
+        }
+
+        options.path = names[0];
+        options.network = names[1];
+
+        if (options.threads.empty())
+        {
+            const size_t cpus = std::max(1u, std::thread::hardware_concurrency());
+            for (size_t t = 1; t < cpus; t *= 2)
+            {
+                options.threads.push_back(t);
+            }
+            options.threads.push_back(cpus);
+        }
+
+        std::vector<Row> rows;
+        for (auto threads : options.threads)
+        {
+            auto network = options.network;
+            const auto pos = network.find("%t");
+            if (options.weak && pos != String::npos)
+            {
+                network.replace(pos, 2, std::to_string(threads));
+            }
+
+            printf("threads = %zu, network = %s\n", threads, network.c_str());
+            measure(options, network, threads, rows);
+        }
+
+        auto file = fopen(options.output.c_str(), "w");
+        if (file == nullptr)
+        {
+            throw std::runtime_error(fmt::format("can't open '{}'", options.output));
+        }
+
+        write_rows(file, options, rows);
+        fclose(file);
+
+        printf("\n");
+        write_rows(stdout, options, rows);
+
+        return 0;
+    }
+    catch (std::exception& e)
+    {
+        printf("%s\n", e.what());
+        return -1;
+    }
+}
@@ -0,0 +1,605 @@
+// Writes synthetic TNTP networks (<path>/<name>/<name>_net.tntp, _trips.tntp and optionally
+// _flow.tntp) for benchmarks at controlled scale.
+//
+// Topologies:
+//   grid    square lattice, every node is linked with its 4 neighbours
+//   planar  randomly shifted lattice, links are a spanning comb of lattice links, a part of
+//           the other lattice links and cell diagonals (one per cell, so links don't cross),
+//           the part is chosen to get the requested average degree in [2, 6]
+//   hub     random nodes, every node is linked with its 'degree' nearest hubs, hubs are linked
+//           into a ring and with 4 nearest hubs, hub links have 10x capacity
+//
+// Free flow time is link length divided by speed with +-25% noise, capacity is uniform in
+// [cap_min, cap_max]. Trips connect random zone pairs with given density, flow is uniform in
+// [0, demand]. Flow file holds all-or-nothing assignment on free flow shortest paths.
+
+#include "problems/transport/src/tntp.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <unordered_set>
+
+#include <sys/stat.h>
+
+using t_opt::String;
+
+enum class Topology : uint8_t
+{
+    Grid,
+    Planar,
+    Hub,
+};
+
+struct Options
+{
+    Topology topology = Topology::Grid;
+    size_t nodes = 100;
+    size_t zones = 10;
+    double degree = 4.0;
+    size_t hubs = 0; // 0 means sqrt(nodes) / 2
+
+    double cap_min = 500.0;
+    double cap_max = 2000.0;
+    double speed = 1.0;
+    double b = 0.15;
+    double power = 4.0;
+
+    double demand = 100.0;
+    double density = 1.0;
+
+    uint64_t seed = 1;
+    bool flow = false;
+};
+
+struct Position
+{
+    double x;
+    double y;
+};
+
+struct Link
+{
+    uint32_t source; // 0-based, written as source + 1
+    uint32_t target;
+    double capacity;
+    double length;
+    double free_flow_time;
+};
+
+class Generator
+{
+public:
+    Generator(const Options& options)
+        : options(options)
+        , rng(options.seed)
+    {
+    }
+
+    void
+    generate()
+    {
+        switch (options.topology)
+        {
+            case Topology::Grid:
+                make_lattice(1.0, 0.0, 0.0);
+                break;
+
+            case Topology::Planar:
+            {
+                // comb gives degree 2, the rest of lattice links 2 more and diagonals 2 more
+                const auto extra = std::max(0.0, options.degree - 2.0);
+                make_lattice(std::min(1.0, extra / 2.0), std::min(1.0, std::max(0.0, extra - 2.0) / 2.0), 0.3);
+                break;
+            }
+
+            case Topology::Hub:
+                make_hub();
+                break;
+        }
+
+        make_zones();
+    }
+
+    void
+    write_net(const String& file_name) const;
+
+    void
+    write_trips(const String& file_name) const;
+
+    void
+    write_flow(const String& file_name) const;
+
+    std::vector<Position> positions;
+    std::vector<Link> links;
+    std::vector<uint32_t> zones;
+    std::vector<tntp::Trip> trips; // 0-based nodes
+
+private:
+    double
+    uniform(double a, double b)
+    {
+        return std::uniform_real_distribution<double>(a, b)(rng);
+    }
+
+    void
+    add_link(uint32_t a, uint32_t b, double capacity_k = 1.0)
+    {
+        const auto key = (uint64_t(std::min(a, b)) << 32) + std::max(a, b);
+        if (a == b || link_keys.insert(key).second == false)
+        {
+            return;
+        }
+
+        const auto dx = positions[a].x - positions[b].x;
+        const auto dy = positions[a].y - positions[b].y;
+        const auto length = std::sqrt(dx * dx + dy * dy);
+
+        for (auto s : {a, b})
+        {
+            Link link;
+            link.source = s;
+            link.target = s == a ? b : a;
+            link.capacity = capacity_k * uniform(options.cap_min, options.cap_max);
+            link.length = length;
+            link.free_flow_time = length / options.speed * uniform(0.75, 1.25);
+            links.push_back(link);
+        }
+    }
+
+    // side x side lattice, horizontal links and the first column are always present,
+    // other vertical links are added with probability p_vertical and a diagonal of every
+    // cell with probability p_diagonal
+    void
+    make_lattice(double p_vertical, double p_diagonal, double jitter)
+    {
+        const auto side = std::max<size_t>(2, std::lround(std::sqrt(double(options.nodes))));
+
+        positions.resize(side * side);
+        for (size_t r = 0; r < side; ++r)
+        {
+            for (size_t c = 0; c < side; ++c)
+            {
+                positions[r * side + c] = {c + uniform(-jitter, jitter), r + uniform(-jitter, jitter)};
+            }
+        }
+
+        auto id = [side](size_t r, size_t c) { return uint32_t(r * side + c); };
+
+        for (size_t r = 0; r < side; ++r)
+        {
+            for (size_t c = 0; c < side; ++c)
+            {
+                if (c + 1 < side)
+                {
+                    add_link(id(r, c), id(r, c + 1));
+                }
+
+                if (r + 1 < side && (c == 0 || uniform(0.0, 1.0) < p_vertical))
+                {
+                    add_link(id(r, c), id(r + 1, c));
+                }
+
+                if (r + 1 < side && c + 1 < side && uniform(0.0, 1.0) < p_diagonal)
+                {
+                    if (uniform(0.0, 1.0) < 0.5)
+                    {
+                        add_link(id(r, c), id(r + 1, c + 1));
+                    }
+                    else
+                    {
+                        add_link(id(r, c + 1), id(r + 1, c));
+                    }
+                }
+            }
+        }
+    }
+
+    // k nearest of candidates to position p
+    std::vector<uint32_t>
+    nearest(const Position& p, const std::vector<uint32_t>& candidates, size_t k) const
+    {
+        std::vector<std::pair<double, uint32_t>> d;
+        d.reserve(candidates.size());
+        for (auto c : candidates)
+        {
+            const auto dx = positions[c].x - p.x;
+            const auto dy = positions[c].y - p.y;
+            d.emplace_back(dx * dx + dy * dy, c);
+        }
+
+        k = std::min(k, d.size());
+        std::partial_sort(d.begin(), d.begin() + k, d.end());
+
+        std::vector<uint32_t> result(k);
+        for (size_t i = 0; i < k; ++i)
+        {
+            result[i] = d[i].second;
+        }
+
+        return result;
+    }
+
+    void
+    make_hub()
+    {
+        const auto side = std::sqrt(double(options.nodes));
+        const auto hubs = options.hubs > 0 ? options.hubs : std::max<size_t>(2, side / 2);
+
+        positions.resize(std::max(options.nodes, hubs + 1));
+        for (auto& p : positions)
+        {
+            p = {uniform(0.0, side), uniform(0.0, side)};
+        }
+
+        // the first nodes are hubs, ring goes around the center
+        hub_ids.resize(hubs);
+        for (size_t h = 0; h < hubs; ++h)
+        {
+            hub_ids[h] = h;
+        }
+
+        auto angle = [this, side](uint32_t h)
+        {
+            return std::atan2(positions[h].y - 0.5 * side, positions[h].x - 0.5 * side);
+        };
+        std::sort(hub_ids.begin(), hub_ids.end(), [&angle](uint32_t a, uint32_t b) { return angle(a) < angle(b); });
+
+        for (size_t h = 0; h < hubs; ++h)
+        {
+            add_link(hub_ids[h], hub_ids[(h + 1) % hubs], 10.0);
+            for (auto n : nearest(positions[hub_ids[h]], hub_ids, 5))
+            {
+                add_link(hub_ids[h], n, 10.0);
+            }
+        }
+
+        const auto spokes = std::max<size_t>(1, std::lround(options.degree));
+        for (uint32_t i = hubs; i < positions.size(); ++i)
+        {
+            for (auto h : nearest(positions[i], hub_ids, spokes))
+            {
+                add_link(i, h);
+            }
+        }
+    }
+
+    void
+    make_zones()
+    {
+        // hubs are not zones while there are enough other nodes
+        std::vector<uint32_t> candidates;
+        for (uint32_t i = 0; i < positions.size(); ++i)
+        {
+            if (i >= hub_ids.size() || positions.size() - hub_ids.size() < options.zones)
+            {
+                candidates.push_back(i);
+            }
+        }
+
+        std::shuffle(candidates.begin(), candidates.end(), rng);
+        candidates.resize(std::min(options.zones, candidates.size()));
+        std::sort(candidates.begin(), candidates.end());
+        zones = candidates;
+
+        for (auto s : zones)
+        {
+            for (auto t : zones)
+            {
+                if (s != t && uniform(0.0, 1.0) < options.density)
+                {
+                    trips.push_back({s, t, uniform(0.0, options.demand)});
+                }
+            }
+        }
+    }
+
+    Options options;
+    std::mt19937_64 rng;
+
+    std::unordered_set<uint64_t> link_keys;
+    std::vector<uint32_t> hub_ids;
+};
+
+void
+Generator::write_net(const String& file_name) const
+{
+    auto file = fopen(file_name.c_str(), "w");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("can't open " + file_name);
+    }
+
+    fprintf(file, "<NUMBER OF ZONES> %zu\n", zones.size());
+    fprintf(file, "<NUMBER OF NODES> %zu\n", positions.size());
+    fprintf(file, "<FIRST THRU NODE> 1\n");
+    fprintf(file, "<NUMBER OF LINKS> %zu\n", links.size());
+    fprintf(file, "<END OF METADATA>\n\n");
+    fprintf(file, "~\tinit\tterm\tcapacity\tlength\tfree_flow_time\tb\tpower\tspeed\ttoll\ttype\t;\n");
+
+    for (const auto& link : links)
+    {
+        fprintf(file, "\t%u\t%u\t%.4f\t%.4f\t%.6f\t%g\t%g\t%g\t0\t1\t;\n",
+                link.source + 1, link.target + 1, link.capacity, link.length, link.free_flow_time,
+                options.b, options.power, options.speed);
+    }
+
+    fclose(file);
+}
+
+void
+Generator::write_trips(const String& file_name) const
+{
+    auto file = fopen(file_name.c_str(), "w");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("can't open " + file_name);
+    }
+
+    double total = 0.0;
+    for (const auto& trip : trips)
+    {
+        total += trip.flow;
+    }
+
+    fprintf(file, "<NUMBER OF ZONES> %zu\n", zones.size());
+    fprintf(file, "<TOTAL OD FLOW> %.3f\n", total);
+    fprintf(file, "<END OF METADATA>\n");
+
+    size_t column = 0;
+    for (size_t i = 0; i < trips.size(); ++i)
+    {
+        if (i == 0 || trips[i].source != trips[i - 1].source)
+        {
+            fprintf(file, "\n\nOrigin %u\n", trips[i].source + 1);
+            column = 0;
+        }
+
+        fprintf(file, column == 0 ? "    %u : %.3f;" : "  %u : %.3f;", trips[i].target + 1, trips[i].flow);
+        if (++column == 5)
+        {
+            fprintf(file, "\n");
+            column = 0;
+        }
+    }
+    fprintf(file, "\n");
+
+    fclose(file);
+}
+
+void
+Generator::write_flow(const String& file_name) const
+{
+    const auto nodes = positions.size();
+
+    // outgoing links of every node
+    std::vector<uint32_t> first(nodes + 1, 0);
+    for (const auto& link : links)
+    {
+        first[link.source + 1] += 1;
+    }
+    for (size_t i = 0; i < nodes; ++i)
+    {
+        first[i + 1] += first[i];
+    }
+
+    std::vector<uint32_t> out(links.size());
+    {
+        auto next = first;
+        for (uint32_t e = 0; e < links.size(); ++e)
+        {
+            out[next[links[e].source]++] = e;
+        }
+    }
+
+    std::vector<double> flow(links.size(), 0.0);
+    std::vector<double> dist(nodes);
+    std::vector<uint32_t> pred(nodes);
+    std::vector<uint32_t> order;
+    std::vector<double> demand(nodes);
+
+    using Item = std::pair<double, uint32_t>;
+
+    for (size_t t = 0; t < trips.size(); )
+    {
+        const auto s = trips[t].source;
+
+        std::fill(dist.begin(), dist.end(), t_opt::limits<double>::infinity());
+        std::fill(pred.begin(), pred.end(), tntp::NO_EDGE);
+        std::fill(demand.begin(), demand.end(), 0.0);
+        order.clear();
+
+        std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+        dist[s] = 0.0;
+        queue.push({0.0, s});
+
+        while (queue.empty() == false)
+        {
+            const auto item = queue.top();
+            queue.pop();
+            if (item.first > dist[item.second])
+            {
+                continue;
+            }
+
+            const auto n = item.second;
+            order.push_back(n);
+
+            for (auto i = first[n]; i < first[n + 1]; ++i)
+            {
+                const auto& link = links[out[i]];
+                const auto d = dist[n] + link.free_flow_time;
+                if (d < dist[link.target])
+                {
+                    dist[link.target] = d;
+                    pred[link.target] = out[i];
+                    queue.push({d, link.target});
+                }
+            }
+        }
+
+        for (; t < trips.size() && trips[t].source == s; ++t)
+        {
+            demand[trips[t].target] += trips[t].flow;
+        }
+
+        // push demand back along the shortest paths tree, farthest nodes first
+        for (auto i = order.size(); i-- > 1; )
+        {
+            const auto n = order[i];
+            if (demand[n] != 0.0)
+            {
+                const auto e = pred[n];
+                flow[e] += demand[n];
+                demand[links[e].source] += demand[n];
+            }
+        }
+    }
+
+    auto file = fopen(file_name.c_str(), "w");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("can't open " + file_name);
+    }
+
+    fprintf(file, "From \tTo \tVolume \tCost \n");
+    for (size_t e = 0; e < links.size(); ++e)
+    {
+        const auto& link = links[e];
+        const auto cost = link.free_flow_time * (1.0 + options.b * std::pow(flow[e] / link.capacity, options.power));
+        fprintf(file, "%u\t%u\t%.6f\t%.6f\n", link.source + 1, link.target + 1, flow[e], cost);
+    }
+
+    fclose(file);
+}
+
+static void
+print_usage()
+{
+    printf("Usage: t_opt_tntp_gen [options] path name\n"
+           "  -t grid|planar|hub  topology (grid)\n"
+           "  -n nodes            nodes count, rounded to a square for grid and planar (100)\n"
+           "  -z zones            zones count (10)\n"
+           "  -d degree           planar: average node degree in [2, 6]; hub: hubs per node (4)\n"
+           "  -h hubs             hubs count, default sqrt(nodes) / 2\n"
+           "  -c min:max          capacity range (500:2000)\n"
+           "  -v speed            free flow speed (1)\n"
+           "  -b b -p power       BPR parameters (0.15, 4)\n"
+           "  -q demand           max flow of a trip (100)\n"
+           "  -r density          share of zone pairs with trips (1)\n"
+           "  -s seed             random seed (1)\n"
+           "  -f                  write all-or-nothing flow file\n");
+}
+
+int
+main(int argc, char** argv)
+{
+    Options options;
+    std::vector<String> names;
+
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const String arg = argv[i];
+            const bool has_value = i + 1 < argc;
+
+            if (arg == "-f")
+            {
+                options.flow = true;
+            }
+            else if (arg == "-t" && has_value)
+            {
+                const String t = argv[++i];
+                if (t == "grid")
+                {
+                    options.topology = Topology::Grid;
+                }
+                else if (t == "planar")
+                {
+                    options.topology = Topology::Planar;
+                }
+                else if (t == "hub")
+                {
+                    options.topology = Topology::Hub;
+                }
+                else
+                {
+                    throw std::invalid_argument("unknown topology " + t);
+                }
+            }
+            else if (arg == "-c" && has_value)
+            {
+                const String c = argv[++i];
+                const auto colon = c.find(':');
+                options.cap_min = std::stod(c.substr(0, colon));
+                options.cap_max = colon == String::npos ? options.cap_min : std::stod(c.substr(colon + 1));
+            }
+            else if (arg.size() == 2 && arg[0] == '-' && has_value && std::strchr("nzdhvbpqrs", arg[1]))
+            {
+                const auto value = std::stod(argv[++i]);
+                switch (arg[1])
+                {
+                    case 'n': options.nodes = value; break;
+                    case 'z': options.zones = value; break;
+                    case 'd': options.degree = value; break;
+                    case 'h': options.hubs = value; break;
+                    case 'v': options.speed = value; break;
+                    case 'b': options.b = value; break;
+                    case 'p': options.power = value; break;
+                    case 'q': options.demand = value; break;
+                    case 'r': options.density = value; break;
+                    case 's': options.seed = value; break;
+                }
+            }
+            else if (arg[0] != '-')
+            {
+                names.push_back(arg);
+            }
+            else
+            {
+                print_usage();
+                return 1;
+            }
+        }
+
+        if (names.size() != 2)
+        {
+            print_usage();
+            return 1;
+        }
+
+        const auto& path = names[0];
+        const auto& name = names[1];
+        const auto dir = path + "/" + name;
+        mkdir(dir.c_str(), 0755);
+
+        Generator generator(options);
+        generator.generate();
+
+        const auto prefix = dir + "/" + name;
+        generator.write_net(prefix + "_net.tntp");
+        generator.write_trips(prefix + "_trips.tntp");
+        if (options.flow)
+        {
+            generator.write_flow(prefix + "_flow.tntp");
+        }
+
+        printf("%s: %zu nodes, %zu links, %zu zones, %zu trips\n", dir.c_str(),
+               generator.positions.size(), generator.links.size(),
+               generator.zones.size(), generator.trips.size());
+
+        // check that the files are readable (and create data cache)
+        tntp::Data data;
+        tntp::load_tntp_data(path, name, data);
+
+        return 0;
+    }
+    catch (std::exception& e)
+    {
+        printf("%s\n", e.what());
+        return -1;
+    }
+}
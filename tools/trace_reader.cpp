@@ -0,0 +1,152 @@
+// Prints binary trace (see t_opt/core/trace.hpp) as csv log
+
+#include "core/trace.hpp"
+
+#include <cstring>
+
+using namespace t_opt;
+
+static void
+print_usage()
+{
+    printf("Usage: t_opt_trace [-i] [-e every] [-n rows] file.trace\n"
+           "  -i        print columns and rows count only\n"
+           "  -e every  print every N-th row\n"
+           "  -n rows   print about N rows evenly spread over the trace\n");
+}
+
+static size_t
+count_rows(const String& file_name)
+{
+    TraceReader reader;
+    if (reader.open(file_name) == false)
+    {
+        return 0;
+    }
+
+    std::vector<std::vector<double>> values;
+    uint32_t rows;
+    size_t count = 0;
+
+    while (reader.next(values, rows))
+    {
+        count += rows;
+    }
+
+    return count;
+}
+
+int
+main(int argc, char** argv)
+{
+    bool info = false;
+    size_t every = 1;
+    size_t max_rows = 0;
+    String file_name;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-i") == 0)
+        {
+            info = true;
+        }
+        else if (std::strcmp(argv[i], "-e") == 0 && i + 1 < argc)
+        {
+            every = std::max(1l, std::atol(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+            max_rows = std::max(1l, std::atol(argv[++i]));
+        }
+        else if (argv[i][0] != '-' && file_name.empty())
+        {
+            file_name = argv[i];
+        }
+        else
+        {
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (file_name.empty())
+    {
+        print_usage();
+        return 1;
+    }
+
+    TraceReader reader;
+    if (reader.open(file_name) == false)
+    {
+        return 1;
+    }
+
+    const auto& columns = reader.columns();
+
+    if (info || max_rows > 0)
+    {
+        const auto total = count_rows(file_name);
+        if (info)
+        {
+            for (const auto& column : columns)
+            {
+                printf("%-12s %s\n", column.name.c_str(),
+                       column.kind == LogCell::Kind::Text ? column.text.c_str() :
+                       column.kind == LogCell::Kind::Size ? "size" :
+                       column.single ? "float" : "double");
+            }
+            printf("rows: %zu\n", total);
+            return 0;
+        }
+
+        every = std::max(every, (total + max_rows - 1) / max_rows);
+    }
+
+    for (size_t c = 0; c < columns.size(); ++c)
+    {
+        printf(c == 0 ? "%s" : ";%s", columns[c].name.c_str());
+    }
+    printf("\n");
+
+    std::vector<std::vector<double>> values;
+    uint32_t rows;
+    size_t row = 0;
+
+    while (reader.next(values, rows))
+    {
+        for (uint32_t r = 0; r < rows; ++r, ++row)
+        {
+            if (row % every != 0)
+            {
+                continue;
+            }
+
+            for (size_t c = 0; c < columns.size(); ++c)
+            {
+                const auto& column = columns[c];
+                if (c > 0)
+                {
+                    printf(";");
+                }
+
+                switch (column.kind)
+                {
+                    case LogCell::Kind::Text:
+                        printf("%s", column.text.c_str());
+                        break;
+
+                    case LogCell::Kind::Size:
+                        printf("%zu", size_t(values[c][r]));
+                        break;
+
+                    case LogCell::Kind::Double:
+                        printf("%.*e", column.precision, values[c][r]);
+                        break;
+                }
+            }
+            printf("\n");
+        }
+    }
+
+    return reader.error() ? 1 : 0;
+}